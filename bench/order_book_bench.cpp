@@ -0,0 +1,95 @@
+// Drives OrderBook directly with a mix of resting limits, crossing limits and
+// cancels, then a full serialization, and reports ns/op. With --perf (and a
+// -DVORTEX_ENABLE_PERF=ON build) it also prints per-call hardware counters
+// for each book stage.
+// Usage: vortex_bench_order_book [operations] [--perf]
+#include "vortex/OrderBook.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+void printPerf(const PerfProfile& perf) {
+    std::cout << "\n  " << std::left << std::setw(12) << "stage" << std::right << std::setw(10) << "calls"
+              << std::setw(10) << "cycles" << std::setw(10) << "instr" << std::setw(7) << "IPC"
+              << std::setw(11) << "cache-miss" << std::setw(12) << "branch-miss" << "   (per call)\n";
+    for (std::size_t i = 0; i < kPerfStageCount; ++i) {
+        const auto stage = static_cast<PerfStage>(i);
+        const PerfStageStats& s = perf.stage(stage);
+        if (s.calls == 0) {
+            if (s.unscheduled > 0) {
+                std::cout << "  " << std::left << std::setw(12) << perfStageName(stage) << std::right
+                          << std::setw(10) << s.unscheduled << "  counters never scheduled\n";
+            }
+            continue;
+        }
+        const double calls = static_cast<double>(s.calls);
+        const double cycles = static_cast<double>(s.total.cycles);
+        std::cout << "  " << std::left << std::setw(12) << perfStageName(stage) << std::right << std::fixed
+                  << std::setw(10) << s.calls << std::setprecision(0) << std::setw(10) << cycles / calls
+                  << std::setw(10) << s.total.instructions / calls << std::setprecision(2) << std::setw(7)
+                  << (cycles > 0 ? s.total.instructions / cycles : 0.0) << std::setw(11)
+                  << s.total.cacheMisses / calls << std::setw(12) << s.total.branchMisses / calls << "\n";
+    }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t operations = 200'000;
+    bool perf = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--perf") perf = true;
+        else operations = std::stoul(arg);
+    }
+
+    OrderBook book;
+    book.setTradeLogging(false);
+    if (perf) {
+        std::string error;
+        if (!book.getPerfProfile().enable(&error)) std::cerr << "Warning: --perf ignored: " << error << "\n";
+    }
+
+    // 70% resting limits around 100, 20% crossing limits, 10% cancels of a random earlier id.
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> ids;
+    ids.reserve(operations);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < operations; ++i) {
+        const unsigned roll = rng() % 10;
+        if (roll == 0 && !ids.empty()) {
+            book.cancelOrder(ids[rng() % ids.size()]);
+            continue;
+        }
+        Order order{};
+        order.side = rng() % 2 ? OrderSide::Buy : OrderSide::Sell;
+        order.type = OrderType::Limit;
+        const double offset = static_cast<double>(rng() % 20 + 1) / 10.0;
+        const bool crossing = roll < 3;
+        order.price = order.side == OrderSide::Buy ? 100.0 - offset + (crossing ? 2.0 : 0.0)
+                                                   : 100.0 + offset - (crossing ? 2.0 : 0.0);
+        order.quantity = rng() % 100 + 1;
+        order.peakSize = 0;
+        order.stopPrice = 0;
+        order.expiry = std::chrono::system_clock::time_point::min();
+        ids.push_back(book.addOrder(std::move(order)));
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(operations);
+
+    start = std::chrono::steady_clock::now();
+    const std::size_t bytes = book.toJson(false).dump().size();
+    const double serializeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << operations << " operations, " << book.getTrades().size() << " trades, "
+              << book.getAllOrders().size() << " live orders\n"
+              << "  order flow   " << std::fixed << std::setprecision(1) << ns << " ns/op\n"
+              << "  serialize    " << serializeMs << " ms (" << bytes << " bytes)\n";
+    if (book.getPerfProfile().enabled()) printPerf(book.getPerfProfile());
+    return 0;
+}
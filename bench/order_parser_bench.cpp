@@ -0,0 +1,85 @@
+// Compares the order-entry body parser with the nlohmann DOM path it replaced.
+// Usage: vortex_bench_parser [iterations]
+#include "vortex/OrderParser.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+static std::atomic<uint64_t> g_allocations{0};
+
+// Every replaceable form is routed through the same pair, so no allocation is
+// ever released by a mismatched function.
+static void* countedAlloc(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+static void countedFree(void* p) noexcept { std::free(p); }
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { countedFree(p); }
+
+namespace {
+
+// Mirrors the previous POST /api/v1/orders handler.
+OrderCommand parseWithDom(const std::string& body) {
+    auto j = json::parse(body);
+    OrderCommand cmd;
+    cmd.side      = j.at("side").get<OrderSide>();
+    cmd.type      = j.at("type").get<OrderType>();
+    cmd.price     = j.value("price", 0.0);
+    cmd.stopPrice = j.value("stopPrice", 0.0);
+    cmd.quantity  = j.at("quantity").get<uint64_t>();
+    cmd.peakSize  = j.value("peakSize", 0ULL);
+    cmd.expirySec = j.value("expirySec", 0ULL);
+    return cmd;
+}
+
+template <typename F>
+void run(const char* name, std::size_t iterations, F&& parseOne) {
+    uint64_t checksum = 0;
+    const uint64_t allocsBefore = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) checksum += parseOne(i);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    const uint64_t allocs = g_allocations.load() - allocsBefore;
+    const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+    std::cout << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << ns << " ns/op" << std::setw(10)
+              << static_cast<double>(allocs) / static_cast<double>(iterations) << " allocs/op"
+              << "   (checksum " << checksum << ")\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    const std::size_t iterations = argc > 1 ? std::stoul(argv[1]) : 1'000'000;
+    const std::vector<std::string> bodies = {
+        R"({"side":"buy","type":"limit","quantity":10,"price":150.75})",
+        R"({ "side": "sell", "type": "iceberg", "quantity": 5000, "price": 151.25, "peakSize": 100, "expirySec": 3600 })",
+        R"({"side":"buy","type":"stop","quantity":25,"price":0,"stopPrice":149.5,"clientTag":"abc-123"})",
+    };
+
+    std::cout << "Parsing " << iterations << " order bodies\n";
+    run("nlohmann DOM", iterations, [&](std::size_t i) {
+        return parseWithDom(bodies[i % bodies.size()]).quantity;
+    });
+    run("in-place", iterations, [&](std::size_t i) {
+        OrderCommand cmd;
+        if (parseOrderCommand(bodies[i % bodies.size()], cmd)) std::abort();
+        return cmd.quantity;
+    });
+    return 0;
+}
@@ -0,0 +1,95 @@
+// Compares OrderTable with the std::pmr::map<uint64_t, Order> it replaced as
+// the book's live-order index: random lookups, lookups in id order (what the
+// match loop does as it walks a price level) and steady-state churn.
+// Usage: vortex_bench_order_table [liveOrders] [operations]
+#include "vortex/OrderTable.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using OrderMap = std::pmr::map<uint64_t, Order>;
+
+Order makeOrder(uint64_t id, std::pmr::memory_resource* resource) {
+    Order order(resource);
+    order.id = id;
+    order.quantity = id % 100 + 1;
+    order.remaining = order.quantity;
+    return order;
+}
+
+// Both indexes expose the same three operations to the benchmark loops.
+struct MapIndex {
+    OrderMap orders;
+    explicit MapIndex(std::pmr::memory_resource* resource) : orders(resource) {}
+    void insert(Order order) { orders[order.id] = std::move(order); }
+    Order& at(uint64_t id) { return orders.at(id); }
+    void erase(uint64_t id) { orders.erase(id); }
+};
+
+struct TableIndex {
+    OrderTable orders;
+    explicit TableIndex(std::pmr::memory_resource* resource) : orders(resource) {}
+    void insert(Order order) { orders.insert(std::move(order)); }
+    Order& at(uint64_t id) { return orders.at(id); }
+    void erase(uint64_t id) { orders.erase(id); }
+};
+
+template <typename F>
+void run(const char* name, std::size_t operations, F&& body) {
+    auto start = std::chrono::steady_clock::now();
+    const uint64_t checksum = body();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(operations);
+    std::cout << "  " << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << ns << " ns/op   (checksum " << checksum << ")\n";
+}
+
+template <typename Index>
+void benchmark(const char* title, std::size_t live, std::size_t operations) {
+    std::pmr::unsynchronized_pool_resource pool;
+    Index index(&pool);
+    for (uint64_t id = 1; id <= live; ++id) index.insert(makeOrder(id, &pool));
+
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> randomIds(operations);
+    for (auto& id : randomIds) id = rng() % live + 1;
+
+    std::cout << title << "\n";
+    run("random lookup", operations, [&] {
+        uint64_t sum = 0;
+        for (uint64_t id : randomIds) sum += index.at(id).remaining;
+        return sum;
+    });
+    run("sequential lookup", operations, [&] {
+        uint64_t sum = 0;
+        for (std::size_t i = 0; i < operations; ++i) sum += index.at(i % live + 1).remaining;
+        return sum;
+    });
+    // Oldest order leaves, a new one arrives: the window slides forward.
+    run("churn (erase+insert)", operations, [&] {
+        uint64_t oldest = 1, next = live + 1;
+        for (std::size_t i = 0; i < operations; ++i) {
+            index.erase(oldest++);
+            index.insert(makeOrder(next++, &pool));
+        }
+        return next;
+    });
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    const std::size_t live = argc > 1 ? std::stoul(argv[1]) : 100'000;
+    const std::size_t operations = argc > 2 ? std::stoul(argv[2]) : 2'000'000;
+    std::cout << live << " live orders, " << operations << " operations\n";
+    benchmark<MapIndex>("std::pmr::map", live, operations);
+    benchmark<TableIndex>("OrderTable", live, operations);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "Trade.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// One OHLCV bar. `start` is the bar's open time in ms since the Unix epoch;
+// intervals without trades produce no bar.
+struct Bar {
+    int64_t start = 0;
+    double open = 0.0;
+    double high = 0.0;
+    double low = 0.0;
+    double close = 0.0;
+    uint64_t volume = 0;
+    double notional = 0.0;  // sum of price * quantity, for the VWAP
+    uint64_t trades = 0;
+
+    double vwap() const { return volume ? notional / static_cast<double>(volume) : 0.0; }
+};
+
+struct BarSpec {
+    int64_t intervalMs;
+    std::size_t capacity;  // bars kept; older ones are overwritten
+};
+
+// Bars of one interval in a fixed-size ring, oldest first.
+class BarSeries {
+public:
+    explicit BarSeries(const BarSpec& spec);
+
+    // Folds a trade into the current bar, or opens a new one once its interval
+    // has passed. A trade stamped before the current bar (e.g. after a clock
+    // step) is folded into the current bar.
+    void add(double price, uint64_t quantity, int64_t timestampMs);
+    // Bars whose start lies in [fromMs, toMs], oldest first.
+    std::vector<Bar> query(int64_t fromMs, int64_t toMs) const;
+    // [{start, end, open, high, low, close, volume, vwap, trades}, ...]
+    static nlohmann::json toJson(const std::vector<Bar>& bars, int64_t intervalMs);
+
+    int64_t intervalMs() const { return spec.intervalMs; }
+    std::size_t size() const { return count; }
+    void clear();
+
+private:
+    const Bar& at(std::size_t i) const { return ring[(head + i) % ring.size()]; }
+
+    BarSpec spec;
+    std::vector<Bar> ring;
+    std::size_t head = 0;   // index of the oldest bar
+    std::size_t count = 0;
+};
+
+// Maintains one BarSeries per configured interval, updated trade by trade.
+class BarAggregator {
+public:
+    // 1s for an hour, 1m for a day, 5m for a week.
+    static std::vector<BarSpec> defaultSpecs();
+
+    explicit BarAggregator(const std::vector<BarSpec>& specs = defaultSpecs());
+
+    void onTrade(const Trade& trade);
+    // nullptr if the interval is not configured.
+    const BarSeries* find(int64_t intervalMs) const;
+    const std::vector<BarSeries>& getSeries() const { return series; }
+    void clear();
+
+private:
+    std::vector<BarSeries> series;
+};
+
+// "1s", "1m", "5m", "1h", or a bare number of milliseconds. Throws
+// std::invalid_argument on anything else.
+int64_t parseBarInterval(const std::string& s);
+std::string formatBarInterval(int64_t intervalMs);
+// Comma-separated intervals, e.g. "1s,1m,5m". The default intervals keep
+// their default history; any other interval keeps 1440 bars.
+std::vector<BarSpec> parseBarSpecs(const std::string& list);
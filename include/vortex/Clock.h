@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Time source for the engine. Every implementation reports wall time as
+// nanoseconds since the Unix epoch, so timestamps from different sources
+// stay comparable and persist the same way.
+class EngineClock {
+public:
+    virtual ~EngineClock() = default;
+    virtual int64_t nowNanos() = 0;
+
+    std::chrono::system_clock::time_point now() {
+        return std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(nowNanos())));
+    }
+};
+
+enum class ClockKind { System, Monotonic, Tsc, Simulated };
+
+// std::chrono::system_clock; a vDSO call on Linux, subject to NTP steps.
+class SystemClock : public EngineClock {
+public:
+    int64_t nowNanos() override;
+};
+
+// CLOCK_MONOTONIC_RAW (steady_clock elsewhere), anchored to wall time once
+// at construction so it never steps backwards.
+class MonotonicClock : public EngineClock {
+public:
+    MonotonicClock();
+    int64_t nowNanos() override;
+    static int64_t rawNanos();
+
+private:
+    int64_t wallAnchor;
+    int64_t rawAnchor;
+};
+
+// Reads the CPU timestamp counter, calibrated against MonotonicClock at
+// construction. Requires an invariant TSC, which available() checks through
+// CPUID; only built on x86.
+class TscClock : public EngineClock {
+public:
+    TscClock();
+    int64_t nowNanos() override;
+    static bool available();
+
+private:
+    int64_t wallAnchor;
+    uint64_t tscAnchor;
+    double nanosPerTick;
+};
+
+// Manually driven clock for deterministic replay and tests.
+class SimulatedClock : public EngineClock {
+public:
+    explicit SimulatedClock(int64_t startNanos = 0) : current(startNanos) {}
+    int64_t nowNanos() override { return current.load(std::memory_order_relaxed); }
+    void set(int64_t nanos) { current.store(nanos, std::memory_order_relaxed); }
+    void advance(int64_t nanos) { current.fetch_add(nanos, std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> current;
+};
+
+// Tsc falls back to Monotonic where the CPU has no invariant TSC.
+std::unique_ptr<EngineClock> makeClock(ClockKind kind);
+ClockKind parseClockKind(const std::string& s);
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <memory_resource>
+#include <nlohmann/json.hpp>
+
+// Which resource backs the OrderBook containers.
+//   Global: every node/block goes straight to the global heap.
+//   Pool:   an unsynchronized pool in front of the heap; safe because the
+//           book is only ever touched under the engine mutex.
+enum class MemoryResourceKind { Global, Pool };
+
+NLOHMANN_JSON_SERIALIZE_ENUM(MemoryResourceKind, {
+    {MemoryResourceKind::Global, "global"}, {MemoryResourceKind::Pool, "pool"}
+})
+
+struct AllocationStats {
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t bytesAllocated = 0;
+    uint64_t bytesInUse = 0;
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(AllocationStats, allocations, deallocations, bytesAllocated, bytesInUse)
+
+// containers: requests made by the book's containers.
+// heap:       what actually reached the global heap (pool refills, scratch overflow).
+// lastCommand: heap traffic caused by the most recent mutating call
+//              (bytesInUse is the heap level after it).
+struct MemoryStats {
+    MemoryResourceKind resource = MemoryResourceKind::Global;
+    AllocationStats containers;
+    AllocationStats heap;
+    AllocationStats lastCommand;
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(MemoryStats, resource, containers, heap, lastCommand)
+
+// Pass-through resource that counts the traffic it forwards upstream.
+// Not thread-safe, like the book that owns it.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream) : upstream(upstream) {}
+
+    const AllocationStats& stats() const { return counters; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        void* p = upstream->allocate(bytes, alignment);
+        ++counters.allocations;
+        counters.bytesAllocated += bytes;
+        counters.bytesInUse += bytes;
+        return p;
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        upstream->deallocate(p, bytes, alignment);
+        ++counters.deallocations;
+        counters.bytesInUse -= bytes;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream;
+    AllocationStats counters;
+};
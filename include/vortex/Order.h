@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <chrono>
+#include <memory_resource>
 #include <nlohmann/json.hpp>
 #include "vortex/Utils.h" // Include after json.hpp
 
@@ -21,7 +22,29 @@ NLOHMANN_JSON_SERIALIZE_ENUM(OrderStatus, {
     {OrderStatus::Expired, "expired"}, {OrderStatus::Pending, "pending"}
 })
 
+// Allocator-aware so that containers built on a std::pmr resource place the
+// audit trail in the same resource as the node holding the order. Plain copies
+// (e.g. those handed out by queries) fall back to the default resource.
 struct Order {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    Order() = default;
+    explicit Order(const allocator_type& alloc) : auditTrail(alloc) {}
+    Order(const Order&) = default;
+    Order(Order&&) = default;
+    Order(const Order& other, const allocator_type& alloc)
+        : id(other.id), side(other.side), type(other.type), price(other.price), stopPrice(other.stopPrice),
+          quantity(other.quantity), remaining(other.remaining), peakSize(other.peakSize),
+          visibleQuantity(other.visibleQuantity), timestamp(other.timestamp), expiry(other.expiry),
+          status(other.status), auditTrail(other.auditTrail, alloc) {}
+    Order(Order&& other, const allocator_type& alloc)
+        : id(other.id), side(other.side), type(other.type), price(other.price), stopPrice(other.stopPrice),
+          quantity(other.quantity), remaining(other.remaining), peakSize(other.peakSize),
+          visibleQuantity(other.visibleQuantity), timestamp(other.timestamp), expiry(other.expiry),
+          status(other.status), auditTrail(std::move(other.auditTrail), alloc) {}
+    Order& operator=(const Order&) = default;
+    Order& operator=(Order&&) = default;
+
     uint64_t id;
     OrderSide side;
     OrderType type;
@@ -34,7 +57,10 @@ struct Order {
     std::chrono::system_clock::time_point timestamp;
     std::chrono::system_clock::time_point expiry;
     OrderStatus status;
-    std::vector<std::string> auditTrail;
+    std::pmr::vector<std::pmr::string> auditTrail;
 };
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Order, id, side, type, price, stopPrice, quantity, remaining, peakSize, visibleQuantity, timestamp, expiry, status, auditTrail)
\ No newline at end of file
+// Defined in Order.cpp. "timestamp" stays in milliseconds for existing files;
+// "timestampNs" carries the full resolution and wins when present.
+void to_json(nlohmann::json& j, const Order& o);
+void from_json(const nlohmann::json& j, Order& o);
\ No newline at end of file
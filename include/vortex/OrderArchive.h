@@ -0,0 +1,79 @@
+#pragma once
+#include "Order.h"
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct ArchiveStats {
+    uint64_t orders = 0;
+    uint64_t bytes = 0;
+    uint64_t indexBlocks = 0;
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(ArchiveStats, orders, bytes, indexBlocks)
+
+// Append-only cold store for orders that reached a terminal state.
+// Records are MessagePack-encoded and kept either in memory or in a file.
+// Ids retire out of order, so the index is sparse: one entry per block of
+// records with the id range it covers, and lookups only decode blocks whose
+// range contains the id.
+//
+// A file archive is spill space for the running process, not a store: it is
+// truncated when opened, and history survives restarts through save() and
+// load() like everything else. Appends are buffered and flushed only before
+// the file is read, so retiring an order costs no system call.
+class OrderArchive {
+public:
+    // An empty path keeps the archive in memory. An existing file is truncated.
+    explicit OrderArchive(std::string path = {});
+
+    void append(const Order& order);
+    std::optional<Order> find(uint64_t orderId) const;
+    void forEach(const std::function<void(const Order&)>& fn) const;
+    void clear();
+
+    // Read-only, point-in-time view for another thread. An in-memory archive
+    // is copied; a file archive is reopened and read only up to its current
+    // end, which later appends never touch. The file must not be cleared
+    // while the view is in use.
+    OrderArchive view() const;
+
+    std::size_t size() const { return count; }
+    uint64_t bytes() const { return end; }
+    ArchiveStats stats() const { return {count, end, index.size()}; }
+    const std::string& getPath() const { return path; }
+
+private:
+    struct ViewTag {};
+    OrderArchive(const OrderArchive& source, ViewTag);
+
+    static constexpr std::size_t kRecordsPerBlock = 64;
+
+    struct Block {
+        uint64_t minId;
+        uint64_t maxId;
+        uint64_t offset;
+    };
+
+    // Record layout: [u64 id][u32 length][length bytes of MessagePack].
+    static constexpr std::size_t kHeaderSize = sizeof(uint64_t) + sizeof(uint32_t);
+
+    // Pushes buffered appends to the file so the reader sees them.
+    void flush() const;
+    void read(uint64_t offset, std::size_t len, std::string& out) const;
+    void scan(uint64_t from, uint64_t to, const std::function<bool(uint64_t, uint64_t, uint32_t)>& fn) const;
+    static Order decode(const std::string& payload);
+
+    std::string path;
+    std::string memory;
+    mutable std::ofstream writer;
+    mutable std::ifstream reader;
+    mutable bool unflushed = false;
+
+    std::vector<Block> index;
+    std::size_t count = 0;
+    uint64_t end = 0;
+};
@@ -1,16 +1,90 @@
 #pragma once
 #include "Order.h"
 #include "Trade.h"
+#include "MemoryResources.h"
+#include "OrderArchive.h"
+#include "Clock.h"
+#include "BarAggregator.h"
+#include "OrderTable.h"
+#include "PerfCounters.h"
+#include <array>
 #include <vector>
 #include <deque>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <functional> // For std::greater
+#include <iosfwd>
+
+enum class TradingPhase { Continuous, Auction };
+
+NLOHMANN_JSON_SERIALIZE_ENUM(TradingPhase, {
+    {TradingPhase::Continuous, "continuous"}, {TradingPhase::Auction, "auction"}
+})
+
+// Result of the equilibrium price search run over the crossed part of the book.
+// buyVolume/sellVolume are the cumulative quantities willing to trade at `price`;
+// their difference is the surplus left on the book after uncrossing.
+struct AuctionIndicative {
+    double price = 0.0;
+    uint64_t volume = 0;
+    uint64_t buyVolume = 0;
+    uint64_t sellVolume = 0;
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(AuctionIndicative, price, volume, buyVolume, sellVolume)
+
+// Best bid and offer with the total resting quantity at each; an empty side
+// has size 0. `sequence` advances whenever any of the four values changes.
+struct TopOfBook {
+    double bidPrice = 0.0;
+    uint64_t bidSize = 0;
+    double askPrice = 0.0;
+    uint64_t askSize = 0;
+    uint64_t sequence = 0;
+};
+
+// {"bid": {"price", "size"} | null, "ask": ... | null, "sequence"}
+void to_json(nlohmann::json& j, const TopOfBook& top);
+
+// What save() writes, copied out of the book so that serialization and I/O
+// can run on another thread while the book keeps changing.
+struct BookSnapshot {
+    std::vector<Order> orders;  // live orders, in id order
+    std::vector<Trade> trades;
+    std::vector<uint64_t> queue;
+    std::optional<OrderArchive> archive;  // absent when history is not saved
+    uint64_t nextOrderId = 1;
+    uint64_t nextTradeId = 1;
+    uint64_t journalSequence = 0;
+    TradingPhase phase = TradingPhase::Continuous;
+
+    // Streams the document OrderBook::toJson() builds, one element at a time.
+    void write(std::ostream& out) const;
+    // Writes "<filename>.tmp", syncs it and renames it over `filename`, so
+    // readers, and the file after a crash, are the old file or the complete
+    // new one. Returns the bytes written; throws std::runtime_error on failure.
+    uint64_t writeFile(const std::string& filename) const;
+};
 
 class OrderBook {
 public:
-    OrderBook();
+    using BuyBook = std::pmr::map<double, std::pmr::deque<Order>, std::greater<double>>;
+    using SellBook = std::pmr::map<double, std::pmr::deque<Order>>;
+    using OrderIndex = OrderTable;
+
+    // archivePath: file backing the cold archive of terminal orders; empty keeps it in memory.
+    explicit OrderBook(MemoryResourceKind memoryKind = MemoryResourceKind::Pool, const std::string& archivePath = {});
+    // The containers point into resources owned by this object.
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
 
     uint64_t addOrder(Order order);
+    // `newQuantity` is the order's new total quantity, including what has
+    // already filled; false if it does not exceed the filled quantity.
+    // Reducing the quantity at the same price keeps the order's queue
+    // position; a new price or a larger quantity sends it to the back.
     bool modifyOrder(uint64_t orderId, double newPrice, uint64_t newQuantity);
     bool cancelOrder(uint64_t orderId);
     
@@ -18,36 +92,157 @@ public:
     void triggerStopOrders(double lastTradePrice);
     void printOrderBook() const;
     void printTradeHistory() const;
+
+    // Call auction: while in the Auction phase orders rest without matching.
+    // uncross() executes all crossing volume at the equilibrium price and
+    // returns the book to continuous trading.
+    void beginAuction();
+    std::size_t uncross();
+    TradingPhase getPhase() const { return phase; }
+    AuctionIndicative getIndicativeUncross() const;
+
+    MemoryStats getMemoryStats() const;
+    // Hardware counters around addOrder, matching, cancel and serialization;
+    // collects nothing until enabled.
+    PerfProfile& getPerfProfile() { return perf; }
+    const PerfProfile& getPerfProfile() const { return perf; }
+    // Records a stage sampled outside the book, such as a snapshot written
+    // after the engine lock was released.
+    void recordPerf(PerfStage stage, const PerfSample& start, const PerfSample& end) const {
+        perf.record(stage, start, end);
+    }
+
+    // Clock used for every timestamp the book writes. Not owned; nullptr
+    // restores the built-in system clock.
+    void setClock(EngineClock* clock);
+    // Everything between beginBatch() and endBatch() is stamped with a single
+    // clock read. Outside a batch each mutating call reads the clock once.
+    void beginBatch();
+    void endBatch();
+    std::chrono::system_clock::time_point currentTime() const;
     
-    // Persistence
-    void save(const std::string& filename) const;
+    // Persistence. includeArchive=false writes only live orders.
+    void save(const std::string& filename, bool includeArchive = true) const;
+    // load() also replays "<filename>.journal" when one exists.
     void load(const std::string& filename);
+    // The document save() writes, and its in-memory counterpart to load().
+    nlohmann::json toJson(bool includeArchive = true) const;
+    // Copies everything save() writes. Much cheaper than serializing; the
+    // copy can then be written from any thread.
+    BookSnapshot snapshot(bool includeArchive = true) const;
+    void loadSnapshot(const nlohmann::json& j);
+
+    // Incremental persistence. With change tracking on, saveIncremental()
+    // appends the orders and trades changed since the last call, and the
+    // trading phase, to "<filename>.journal"; if the append fails it throws
+    // std::runtime_error and keeps the changes for the next call.
+    // checkpoint() writes a full snapshot and starts a new, empty journal.
+    // Journal records are numbered and snapshots record the last number they
+    // include, so load() never applies a change twice.
+    void setChangeTracking(bool enabled);
+    void saveIncremental(const std::string& filename);
+    void checkpoint(const std::string& filename);
+
+    // Echo each trade to stdout (on by default, for the interactive CLI).
+    void setTradeLogging(bool enabled) { tradeLogging = enabled; }
+
+    // Change counters for cached read views. bookSequence advances whenever an
+    // order is added, changed or removed, tradeSequence whenever a trade prints;
+    // both advance on load(). Equal values mean identical content.
+    uint64_t getBookSequence() const { return bookSequence; }
+    uint64_t getTradeSequence() const { return tradeSequence; }
+
+    // Kept current as orders rest, trade and leave, so reading it never walks
+    // the price maps. Adds that cannot reach the opposite best skip matching.
+    const TopOfBook& getTopOfBook() const { return top; }
+
+    // OHLCV bars, updated as each trade prints. setBarSpecs() replaces the
+    // configured intervals and rebuilds them from the trade history.
+    void setBarSpecs(const std::vector<BarSpec>& specs);
+    const BarAggregator& getBars() const { return bars; }
+
+    // Resolves live orders from the hot index and historical ones from the archive.
+    std::optional<Order> findOrder(uint64_t orderId) const;
 
     // Public accessors for engine
-    const std::map<uint64_t, Order>& getAllOrders() const { return allOrders; }
-    const std::vector<Trade>& getTrades() const { return trades; }
-    const std::map<double, std::deque<Order>, std::greater<double>>& getBuyOrders() const { return buyOrders; }
-    const std::map<double, std::deque<Order>>& getSellOrders() const { return sellOrders; }
+    // Live (Active/Pending) orders only; terminal orders move to the archive.
+    const OrderIndex& getAllOrders() const { return allOrders; }
+    const OrderArchive& getArchive() const { return archive; }
+    const std::pmr::vector<Trade>& getTrades() const { return trades; }
+    const BuyBook& getBuyOrders() const { return buyOrders; }
+    const SellBook& getSellOrders() const { return sellOrders; }
 
 
 private:
+    // Records the heap traffic of one mutating call, resets the scratch arena
+    // and pins the timestamp used by the call.
+    class CommandScope {
+    public:
+        explicit CommandScope(OrderBook& book);
+        ~CommandScope();
+    private:
+        OrderBook& book;
+        AllocationStats heapBefore;
+    };
+
+    // Memory resources. Declared ahead of the containers so they outlive them.
+    // Chain: containers -> bookCounter -> [pool] -> heapCounter -> global heap.
+    MemoryResourceKind memoryKind;
+    CountingResource heapCounter;
+    std::unique_ptr<std::pmr::memory_resource> pool;
+    CountingResource bookCounter;
+    // Per-command scratch; released at the end of every mutating call.
+    std::array<std::byte, 16 * 1024> scratchBuffer;
+    mutable std::pmr::monotonic_buffer_resource scratch;
+    AllocationStats lastCommandHeap;
+    mutable PerfProfile perf;  // mutable: serialization is const
+
+    EngineClock* clock;
+    std::chrono::system_clock::time_point stampTime;
+    int stampDepth;
+
     // Data Structures: Use maps for price-time priority.
     // Buys: sorted high to low price. Sells: sorted low to high price.
-    std::map<double, std::deque<Order>, std::greater<double>> buyOrders;
-    std::map<double, std::deque<Order>> sellOrders;
+    BuyBook buyOrders;
+    SellBook sellOrders;
 
-    std::map<uint64_t, Order> allOrders;
-    std::vector<Order> stopOrders;
-    std::vector<Trade> trades;
+    OrderIndex allOrders;
+    std::pmr::vector<Order> stopOrders;
+    std::pmr::vector<Trade> trades;
+    OrderArchive archive;
+    BarAggregator bars;
+
+    bool tradeLogging;
+    bool trackChanges;
+    std::pmr::vector<uint64_t> dirtyOrders;  // may repeat ids; deduplicated on save
+    std::size_t tradesSaved;
+
+    uint64_t bookSequence;
+    uint64_t tradeSequence;
     
     uint64_t nextOrderId;
     uint64_t nextTradeId;
+    uint64_t journalSequence;  // journal records written; saved with snapshots
+    TradingPhase phase;
+    TopOfBook top;
 
     void matchOrders();
+    // True if `order` meets or betters the opposite side's best price.
+    bool crossesTop(const Order& order) const;
+    // Recomputes the top of book from the best levels.
+    void refreshTop();
+    void setTop(double bidPrice, uint64_t bidSize, double askPrice, uint64_t askSize);
+    void executeAtTop(double tradePrice, uint64_t qty);
     void matchAdvancedOrder(Order& order);
     void addTrade(const Trade& trade);
     void addOrderToBook(Order order);
     void removeOrderFromBook(uint64_t orderId);
+    bool reduceOrder(Order& order, uint64_t newQuantity);
+    void retireOrder(uint64_t orderId);
     void replenishIcebergOrder(Order& order);
     void addAuditTrail(Order& order, const std::string& action);
+    void restoreState(const nlohmann::json& j);
+    void rebuildDerivedState(const nlohmann::json* saved);
+    void pushStamp();
+    void popStamp();
 };
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+#include "Order.h"
+#include <cstdint>
+
+enum class CommandKind { New, Cancel, Amend };
+
+// A request as it travels from the API threads to the engine thread. New
+// orders use every field but orderId. Cancel and Amend name an existing order
+// by orderId; an amend carries the new price and quantity, 0 keeping the
+// current value.
+struct OrderCommand {
+    OrderSide side;
+    OrderType type;
+    double price;
+    double stopPrice;
+    uint64_t quantity;
+    uint64_t peakSize;
+    uint64_t expirySec;
+    CommandKind kind = CommandKind::New;
+    uint64_t orderId = 0;
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include "OrderCommand.h"
+#include <string_view>
+
+// Parses the POST /api/v1/orders body straight into an OrderCommand without
+// building a DOM or allocating. Accepts exactly one JSON object; unknown keys
+// are skipped, the last occurrence of a repeated key wins.
+//
+// Required: "side" (buy|sell), "type" (limit|market|stop|iceberg|fok|ioc),
+// "quantity" (integer > 0). Optional, defaulting to 0: "price", "stopPrice"
+// (finite, >= 0), "peakSize", "expirySec" (non-negative integers).
+//
+// Returns nullptr on success, otherwise a static description of the error.
+// On failure `out` may be partially written.
+const char* parseOrderCommand(std::string_view body, OrderCommand& out);
+
+// Parses the PATCH /api/v1/orders/<id> body into an Amend command (orderId is
+// left to the caller). Optional "price" (finite, > 0) and "quantity" (integer
+// > 0, the new total including fills); at least one is required, and an
+// absent one keeps the current value.
+const char* parseAmendCommand(std::string_view body, OrderCommand& out);
+
+// Parses a WebSocket subscriber's acknowledgement, {"ack": <n>}, where n is
+// the number of frames it has received since connecting.
+const char* parseWsAck(std::string_view body, uint64_t& received);
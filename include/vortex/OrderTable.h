@@ -0,0 +1,86 @@
+#pragma once
+#include "Order.h"
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <stdexcept>
+
+// Live orders indexed directly by id. Ids are handed out densely by the book,
+// so the table is a window of fixed-size chunks starting at `base`: a lookup
+// is two array indexations instead of a tree walk.
+//
+// A chunk is freed as soon as its last order leaves, so the memory held is
+// proportional to the number of chunks with a live order, not to the id range;
+// freed chunks at either end of the window are trimmed, which advances `base`
+// past retired ids. One freed chunk is kept for reuse so a book that keeps
+// emptying out does not allocate per order.
+//
+// Chunks and the chunk directory come from the given resource.
+class OrderTable {
+public:
+    static constexpr std::size_t kChunkSize = 256;
+
+    explicit OrderTable(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    ~OrderTable();
+    OrderTable(const OrderTable&) = delete;
+    OrderTable& operator=(const OrderTable&) = delete;
+
+    Order* find(uint64_t id) {
+        return const_cast<Order*>(static_cast<const OrderTable&>(*this).find(id));
+    }
+    const Order* find(uint64_t id) const {
+        if (id < base) return nullptr;
+        const uint64_t offset = id - base;
+        const uint64_t c = offset / kChunkSize;
+        if (c >= chunks.size() || !chunks[c]) return nullptr;
+        const Chunk& chunk = *chunks[c];
+        const std::size_t slot = offset % kChunkSize;
+        return chunk.live[slot] ? &chunk.orders[slot] : nullptr;
+    }
+    // Like std::map::at: throws std::out_of_range for an id that is not live.
+    Order& at(uint64_t id) {
+        if (Order* order = find(id)) return *order;
+        throw std::out_of_range("OrderTable::at: unknown order id");
+    }
+    const Order& at(uint64_t id) const { return const_cast<OrderTable&>(*this).at(id); }
+
+    // Stores `order` under order.id, replacing any live order with that id.
+    Order& insert(Order order);
+    bool erase(uint64_t id);
+    void clear();
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    // Ids covered by the current window, live or not.
+    std::size_t capacity() const { return chunks.size() * kChunkSize; }
+
+    // Visits live orders in id order.
+    template <typename F>
+    void forEach(F&& fn) const {
+        for (const Chunk* chunk : chunks) {
+            if (!chunk) continue;
+            for (std::size_t i = 0; i < kChunkSize; ++i) {
+                if (chunk->live[i]) fn(chunk->orders[i]);
+            }
+        }
+    }
+
+private:
+    struct Chunk {
+        explicit Chunk(std::pmr::memory_resource* resource) : orders(kChunkSize, resource) {}
+        std::pmr::vector<Order> orders;
+        std::array<bool, kChunkSize> live{};
+        std::size_t liveCount = 0;
+    };
+
+    Chunk* acquireChunk();
+    void releaseChunk(Chunk* chunk);
+    void destroyChunk(Chunk* chunk);
+
+    std::pmr::memory_resource* resource;
+    std::pmr::deque<Chunk*> chunks;  // nullptr: no live orders in that range
+    uint64_t base = 0;               // id of chunks[0]'s first slot; a multiple of kChunkSize
+    std::size_t count = 0;
+    Chunk* spare = nullptr;
+};
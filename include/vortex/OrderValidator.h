@@ -0,0 +1,53 @@
+#pragma once
+#include "OrderCommand.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+struct ValidationLimits {
+    double tickSize = 0.01;              // Prices are rounded to a multiple of this.
+    uint64_t lotSize = 1;                // Quantities are rounded down to a multiple of this.
+    uint64_t maxOrderQuantity = 1000000;
+    double priceBand = 0.10;             // Max relative distance from the reference price; 0 disables.
+};
+
+// Pre-trade checks and normalization, run on the submitting (API/CLI) thread
+// so a rejected order never costs engine-thread time and the engine only
+// ever sees well-formed commands.
+//
+// validate() checks that the fields match the order type, rounds prices to
+// the tick (buys down, sells up, so never past the client's limit) and
+// quantities down to the lot, and rejects prices outside the band around the
+// reference price. The reference is the last trade, or the BBO mid before the
+// first trade; the engine thread publishes it with setReferencePrice().
+// Cancels pass unchecked; amends get the quantity, tick and band checks.
+class OrderValidator {
+public:
+    explicit OrderValidator(const ValidationLimits& limits = {});
+
+    // Returns nullptr and normalizes `cmd` in place when the order is
+    // acceptable, otherwise a static description of the rejection.
+    // Safe to call from any number of threads.
+    const char* validate(OrderCommand& cmd) const;
+
+    // Not synchronized with validate(); set limits before submitting orders.
+    void setLimits(const ValidationLimits& newLimits) { limits = newLimits; }
+    const ValidationLimits& getLimits() const { return limits; }
+
+    // 0 means no reference yet; the band check is skipped until there is one.
+    void setReferencePrice(double price) { reference.store(price, std::memory_order_relaxed); }
+    double getReferencePrice() const { return reference.load(std::memory_order_relaxed); }
+
+private:
+    const char* validateAmend(OrderCommand& cmd) const;
+    bool roundPrice(double& price, OrderSide side) const;
+    bool inBand(double price) const;
+
+    ValidationLimits limits;
+    std::atomic<double> reference{0.0};
+};
+
+// Applies one of --tick-size=, --lot-size=, --max-order-qty=, --price-band=
+// to `limits`. Returns false if `arg` is not one of them; throws
+// std::invalid_argument on a bad value.
+bool parseValidationArg(const std::string& arg, ValidationLimits& limits);
@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <nlohmann/json.hpp>
+
+// Hardware counters sampled around engine stages through Linux
+// perf_event_open. Compiled in only with -DVORTEX_ENABLE_PERF=ON and off
+// until enabled at runtime; until then a PerfScope is a single branch.
+enum class PerfStage { AddOrder, Match, Cancel, Serialize };
+constexpr std::size_t kPerfStageCount = 4;
+const char* perfStageName(PerfStage stage);
+
+struct PerfSample {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cacheMisses = 0;
+    uint64_t branchMisses = 0;
+    // How long the group was enabled and actually counting. They differ when
+    // the kernel multiplexes the PMU; counts are scaled by their ratio.
+    uint64_t timeEnabled = 0;
+    uint64_t timeRunning = 0;
+};
+
+struct PerfStageStats {
+    uint64_t calls = 0;        // calls measured, with counts scaled for multiplexing
+    uint64_t unscheduled = 0;  // calls during which the group never ran; not in total
+    PerfSample total;
+};
+
+// Reads the calling thread's counters (user space only), opening them on the
+// thread's first call. False if they are unavailable.
+bool readPerfCounters(PerfSample& out);
+
+// Per-stage totals. Stages nest (addOrder includes the match it triggers), so
+// figures are inclusive. Not thread-safe, like the book that owns it.
+class PerfProfile {
+public:
+    // Checks that the calling thread can open the counters; on failure returns
+    // false and sets `error` (no build support, no PMU, perf_event_paranoid).
+    bool enable(std::string* error = nullptr);
+    void disable() { on = false; }
+    bool enabled() const { return on; }
+    void reset() { totals = {}; }
+
+    void record(PerfStage stage, const PerfSample& start, const PerfSample& end);
+    const PerfStageStats& stage(PerfStage s) const { return totals[static_cast<std::size_t>(s)]; }
+    // {"<stage>": {calls, unscheduled, cycles, instructions, cacheMisses,
+    // branchMisses}} for stages that ran.
+    nlohmann::json toJson() const;
+
+private:
+    bool on = false;
+    std::array<PerfStageStats, kPerfStageCount> totals{};
+};
+
+class PerfScope {
+public:
+    PerfScope(PerfProfile& profile, PerfStage stage)
+        : profile(profile), stage(stage), active(profile.enabled() && readPerfCounters(start)) {}
+    ~PerfScope() {
+        PerfSample end;
+        if (active && readPerfCounters(end)) profile.record(stage, start, end);
+    }
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    PerfProfile& profile;
+    PerfStage stage;
+    PerfSample start;
+    bool active;
+};
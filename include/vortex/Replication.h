@@ -0,0 +1,107 @@
+#pragma once
+#include "matching_engine.h"
+#include "Clock.h"
+#include "Socket.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams every change the primary applies to read replicas over TCP, one
+// JSON event per line (see MatchingEngine::subscribe). Each follower gets its
+// own queue and sender thread, so a slow replica never stalls the engine; one
+// that falls maxQueued events behind is dropped and resyncs on reconnect.
+class ReplicationPublisher {
+public:
+    explicit ReplicationPublisher(MatchingEngine& engine, std::size_t maxQueued = 65536);
+    ~ReplicationPublisher();
+
+    // Throws std::runtime_error if it cannot listen on bindAddress:port.
+    void start(uint16_t port, const std::string& bindAddress = "0.0.0.0");
+    void stop();
+    std::size_t followers() const;
+
+private:
+    class Follower : public ReplicationSink {
+    public:
+        Follower(Net::SocketHandle socket, std::size_t maxQueued);
+        ~Follower() override;
+        void onEvent(const std::string& line) override;
+        void onSnapshot(std::shared_ptr<const SnapshotEvent> snapshot) override;
+        bool isDone() const { return done.load(); }
+
+    private:
+        // A line, or a snapshot encoded by the sender thread.
+        struct Entry {
+            std::string line;
+            std::shared_ptr<const SnapshotEvent> snapshot;
+        };
+
+        void push(Entry entry);
+        void close();
+        void sendLoop();
+
+        Net::SocketHandle socket;
+        const std::size_t maxQueued;
+        std::mutex mtx;
+        std::condition_variable ready;
+        std::deque<Entry> queue;
+        bool closed = false;
+        std::atomic<bool> done{false};
+        std::thread sender;
+    };
+
+    void acceptLoop();
+    // Unsubscribes and releases followers whose connection has ended.
+    void reap();
+
+    MatchingEngine& engine;
+    const std::size_t maxQueued;
+    Net::SocketHandle listener = Net::kInvalidSocket;
+    std::atomic<bool> running{false};
+    std::thread acceptor;
+    mutable std::mutex followersMutex;
+    std::vector<std::unique_ptr<Follower>> active;
+};
+
+// Keeps a replica engine in step with a primary: loads its snapshot, then
+// replays each event at the primary's timestamp through a SimulatedClock the
+// engine was given, so ids, trades and expiries come out identical. On a
+// disconnect or any divergence it reconnects and starts over from a fresh
+// snapshot.
+class ReplicationFollower {
+public:
+    ReplicationFollower(MatchingEngine& engine, SimulatedClock& clock, std::string host, uint16_t port);
+    ~ReplicationFollower();
+
+    void start();
+    void stop();
+    // True between a loaded snapshot and the next disconnect.
+    bool isSynced() const { return synced.load(); }
+    uint64_t eventsApplied() const { return applied.load(); }
+
+private:
+    void run();
+    // Reads events until the stream ends or one fails to apply.
+    void follow(Net::SocketHandle socket);
+    void apply(const nlohmann::json& event);
+    void pause(std::chrono::milliseconds duration) const;
+
+    MatchingEngine& engine;
+    SimulatedClock& clock;
+    const std::string host;
+    const uint16_t port;
+    std::atomic<bool> running{false};
+    std::atomic<bool> synced{false};
+    std::atomic<uint64_t> applied{0};
+    std::thread worker;
+    std::mutex socketMutex;
+    Net::SocketHandle current = Net::kInvalidSocket;
+};
+
+// Parses "host:port" (as given to --replica-of=). Throws std::invalid_argument.
+void parseHostPort(const std::string& s, std::string& host, uint16_t& port);
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Minimal blocking TCP helpers for replication: BSD sockets, with Winsock
+// behind the same calls on Windows.
+namespace Net {
+
+using SocketHandle = std::intptr_t;
+constexpr SocketHandle kInvalidSocket = -1;
+
+// Listens on bindAddress:port. Throws std::runtime_error on failure.
+SocketHandle listenTcp(uint16_t port, const std::string& bindAddress = "0.0.0.0");
+// Waits up to timeoutMs for a connection; kInvalidSocket on timeout or error.
+SocketHandle acceptTcp(SocketHandle listener, int timeoutMs);
+// kInvalidSocket if the host cannot be resolved or reached.
+SocketHandle connectTcp(const std::string& host, uint16_t port);
+
+// False once the peer is gone.
+bool sendAll(SocketHandle socket, const char* data, std::size_t len);
+// Bytes read, 0 at end of stream, -1 on error.
+long receive(SocketHandle socket, char* buf, std::size_t len);
+
+// Wakes any thread blocked on the socket; closeSocket() releases it.
+void shutdownSocket(SocketHandle socket);
+void closeSocket(SocketHandle socket);
+
+}
@@ -22,15 +22,39 @@ public:
         return true;
     }
 
-    void wait_and_pop(T& value) {
+    // Blocks until an item is available. Returns false once the queue has
+    // been closed and everything pushed before close() has been popped.
+    bool wait_and_pop(T& value) {
         std::unique_lock<std::mutex> lock(mtx);
-        cond.wait(lock, [this] { return !queue.empty(); });
+        cond.wait(lock, [this] { return !queue.empty() || closed; });
+        if (queue.empty()) {
+            return false;
+        }
         value = std::move(queue.front());
         queue.pop();
+        return true;
+    }
+
+    // Wakes every waiter; pushes are still accepted and kept for reopen().
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        cond.notify_all();
+    }
+
+    void reopen() {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = false;
+    }
+
+    std::size_t size() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return queue.size();
     }
 
 private:
     std::queue<T> queue;
     std::mutex mtx;
     std::condition_variable cond;
-};
\ No newline at end of file
+    bool closed = false;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+// Small portability layer for thread placement. Every function is best
+// effort: it returns false where the platform offers no such control.
+namespace Threading {
+    // Restricts the calling thread to a single logical CPU.
+    bool pinCurrentThread(int cpu);
+    // Removes one CPU from the calling thread's affinity mask. Threads
+    // spawned afterwards inherit the reduced mask.
+    bool excludeCpuFromCurrentThread(int cpu);
+    unsigned cpuCount();
+    // Spin-wait hint (PAUSE on x86, yield elsewhere).
+    void cpuRelax();
+}
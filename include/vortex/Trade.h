@@ -13,5 +13,6 @@ struct Trade {
     std::chrono::system_clock::time_point timestamp;
 };
 
-// Use this macro to explicitly define serialization for the Trade struct
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Trade, tradeId, buyOrderId, sellOrderId, price, quantity, timestamp)
\ No newline at end of file
+// Defined in Trade.cpp; timestamps are persisted like Order's (ms + "timestampNs").
+void to_json(nlohmann::json& j, const Trade& t);
+void from_json(const nlohmann::json& j, Trade& t);
\ No newline at end of file
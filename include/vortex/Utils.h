@@ -31,8 +31,12 @@ namespace nlohmann {
 
 namespace Utils {
     std::string formatTime(const std::chrono::system_clock::time_point& tp);
+    // Allocation-free variant; writes at most len-1 chars and returns the count.
+    std::size_t formatTime(const std::chrono::system_clock::time_point& tp, char* buf, std::size_t len);
     std::chrono::system_clock::time_point parseTime(const std::string& s);
     std::chrono::system_clock::time_point now();
+    int64_t toEpochNanos(const std::chrono::system_clock::time_point& tp);
+    std::chrono::system_clock::time_point fromEpochNanos(int64_t nanos);
     std::string orderTypeToStr(OrderType type);
     std::string orderStatusToStr(OrderStatus status);
 }
\ No newline at end of file
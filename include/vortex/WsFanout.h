@@ -0,0 +1,157 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct WsFanoutConfig {
+    std::size_t maxQueued = 8;  // Unacknowledged frames per subscriber before holding back.
+    unsigned maxStrikes = 16;   // Consecutive held-back publishes before disconnecting.
+};
+
+// Fans pre-encoded messages out to WebSocket subscribers without ever
+// blocking the publisher on a client.
+//
+// Sending only hands a frame to the connection, which buffers it without
+// limit and reports nothing back about the socket, so delivery is measured by
+// the client: it reports how many frames it has received (ack()), and a frame
+// counts as outstanding until then. Once maxQueued are outstanding, new
+// messages are held back. Held-back conflatable messages (state snapshots)
+// are replaced by the newest one; non-conflatable ones (deltas) are never
+// dropped, so a subscriber holding back more than maxQueued of them is
+// disconnected, as is one that is still held back after maxStrikes publishes
+// in a row. A client that never acknowledges is therefore disconnected too.
+//
+// Connection needs send_text(std::string) and close(const std::string&),
+// neither of which may block. remove() must be called from the connection's
+// close handler; it waits for any send to that connection in progress.
+template <typename Connection>
+class WsFanout {
+public:
+    using Message = std::shared_ptr<const std::string>;
+
+    explicit WsFanout(WsFanoutConfig config = {}) : config(config) {}
+
+    void add(Connection& conn) {
+        auto sub = std::make_shared<Subscriber>();
+        sub->conn = &conn;
+        std::lock_guard<std::mutex> lock(mtx);
+        subscribers[&conn] = std::move(sub);
+    }
+
+    void remove(Connection& conn) {
+        std::shared_ptr<Subscriber> sub;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = subscribers.find(&conn);
+            if (it == subscribers.end()) return;
+            sub = std::move(it->second);
+            subscribers.erase(it);
+        }
+        std::lock_guard<std::mutex> lock(sub->mtx);
+        sub->conn = nullptr;
+        sub->held.clear();
+    }
+
+    // Sends the same buffer to every subscriber that has room and holds it
+    // back for the rest; never waits for I/O.
+    void publish(const Message& msg, bool conflatable = true) {
+        for (auto& sub : snapshot()) {
+            std::lock_guard<std::mutex> lock(sub->mtx);
+            if (!sub->conn || sub->closing) continue;
+            if (sub->sent - sub->acked < config.maxQueued && sub->held.empty()) {
+                send(*sub, msg);
+                continue;
+            }
+            if (conflatable) {
+                std::deque<Entry> kept;
+                for (auto& e : sub->held) if (!e.conflatable) kept.push_back(std::move(e));
+                sub->held.swap(kept);
+            } else {
+                ++sub->heldDeltas;
+            }
+            sub->held.push_back({msg, conflatable});
+            if (++sub->strikes >= config.maxStrikes || sub->heldDeltas > config.maxQueued) disconnect(*sub);
+        }
+    }
+
+    // `received` is the number of frames the client has received since it
+    // connected. Frees that many slots, less any already acknowledged, for
+    // the oldest held-back messages. Counts beyond what was sent are clamped.
+    void ack(Connection& conn, uint64_t received) {
+        std::shared_ptr<Subscriber> sub;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = subscribers.find(&conn);
+            if (it == subscribers.end()) return;
+            sub = it->second;
+        }
+        std::lock_guard<std::mutex> lock(sub->mtx);
+        if (!sub->conn || sub->closing || received <= sub->acked) return;
+        sub->acked = std::min(received, sub->sent);
+        while (sub->sent - sub->acked < config.maxQueued && !sub->held.empty()) {
+            Entry next = std::move(sub->held.front());
+            sub->held.pop_front();
+            if (!next.conflatable) --sub->heldDeltas;
+            send(*sub, next.msg);
+        }
+        if (sub->held.empty()) sub->strikes = 0;
+    }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return subscribers.size();
+    }
+
+    uint64_t slowConsumersDisconnected() const { return disconnected.load(); }
+
+private:
+    struct Entry {
+        Message msg;
+        bool conflatable;
+    };
+
+    struct Subscriber {
+        std::mutex mtx;            // everything below; held across send_text/close
+        Connection* conn = nullptr;
+        uint64_t sent = 0;         // frames sent since connecting
+        uint64_t acked = 0;        // frames the client reported received
+        std::deque<Entry> held;
+        std::size_t heldDeltas = 0;
+        unsigned strikes = 0;
+        bool closing = false;
+    };
+
+    std::vector<std::shared_ptr<Subscriber>> snapshot() const {
+        std::vector<std::shared_ptr<Subscriber>> subs;
+        std::lock_guard<std::mutex> lock(mtx);
+        subs.reserve(subscribers.size());
+        for (const auto& [conn, sub] : subscribers) subs.push_back(sub);
+        return subs;
+    }
+
+    // Caller holds sub.mtx.
+    void send(Subscriber& sub, const Message& msg) {
+        sub.conn->send_text(*msg);
+        ++sub.sent;
+    }
+
+    // Caller holds sub.mtx.
+    void disconnect(Subscriber& sub) {
+        sub.closing = true;
+        sub.held.clear();
+        sub.heldDeltas = 0;
+        sub.conn->close("slow consumer");
+        ++disconnected;
+    }
+
+    WsFanoutConfig config;
+    mutable std::mutex mtx;
+    std::unordered_map<Connection*, std::shared_ptr<Subscriber>> subscribers;
+    std::atomic<uint64_t> disconnected{0};
+};
@@ -1,49 +1,235 @@
 #pragma once
 #include "OrderBook.h"
 #include "ThreadSafeQueue.h"
+#include "OrderCommand.h"
+#include "OrderValidator.h"
 #include <string>
 #include <optional>
 #include <functional>
 #include <nlohmann/json.hpp>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
 
-struct OrderCommand {
-    OrderSide side;
-    OrderType type;
-    double price;
-    double stopPrice;
-    uint64_t quantity;
-    uint64_t peakSize;
-    uint64_t expirySec;
+// A read view serialized once per state change and shared by every request
+// that sees the same sequence. The ETag also carries a per-process id, so a
+// tag from before a restart never matches.
+struct EncodedSnapshot {
+    uint64_t sequence = 0;
+    std::string etag;
+    std::shared_ptr<const std::string> body;
+};
+
+// A "snapshot" replication event. The book is copied under the engine lock;
+// the line is encoded by whichever sink needs it first, off that lock.
+class SnapshotEvent {
+public:
+    explicit SnapshotEvent(BookSnapshot snapshot) : snapshot(std::move(snapshot)) {}
+    // Thread-safe; encodes once.
+    const std::string& line() const;
+
+private:
+    BookSnapshot snapshot;
+    mutable std::once_flag encoded;
+    mutable std::string text;
+};
+
+// Receives every state change the engine applies, in order, as one JSON line
+// each (snapshots as a SnapshotEvent), with the engine lock held. Feeds read
+// replicas; must not block.
+class ReplicationSink {
+public:
+    virtual ~ReplicationSink() = default;
+    virtual void onEvent(const std::string& line) = 0;
+    virtual void onSnapshot(std::shared_ptr<const SnapshotEvent> snapshot) = 0;
+};
+
+enum class SaveState { Idle, Running, Done, Failed };
+
+NLOHMANN_JSON_SERIALIZE_ENUM(SaveState, {
+    {SaveState::Idle, "idle"}, {SaveState::Running, "running"}, {SaveState::Done, "done"}, {SaveState::Failed, "failed"}
+})
+
+// Progress of the latest background save. copyMs is how long the engine was
+// paused for the point-in-time copy; writeMs covers serialization and I/O.
+struct SaveStatus {
+    SaveState state = SaveState::Idle;
+    std::string file;
+    std::string error;
+    double copyMs = 0.0;
+    double writeMs = 0.0;
+    uint64_t bytes = 0;
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(SaveStatus, state, file, error, copyMs, writeMs, bytes)
+
+struct EngineRunConfig {
+    int cpu = -1;           // Pin the engine thread to this CPU; -1 leaves placement to the OS.
+    bool busyPoll = false;  // Spin on the work queue instead of sleeping on it.
 };
 
 class MatchingEngine {
 public:
-    MatchingEngine();
+    explicit MatchingEngine(MemoryResourceKind memoryKind = MemoryResourceKind::Pool, const std::string& archivePath = {});
+    ~MatchingEngine();
+
+    // Replaces the engine clock (e.g. with a SimulatedClock for replay/tests).
+    void setClock(std::unique_ptr<EngineClock> newClock);
+
+    // Pre-trade validation. Runs on the calling thread without taking the
+    // engine lock; normalizes `cmd` and returns nullptr, or the reason it was
+    // rejected. Set limits before orders start flowing.
+    const char* validateOrder(OrderCommand& cmd) const { return validator.validate(cmd); }
+    void setValidationLimits(const ValidationLimits& limits) { validator.setLimits(limits); }
+    const ValidationLimits& getValidationLimits() const { return validator.getLimits(); }
 
     // --- Methods for the High-Performance API Server ---
-    void postOrder(OrderSide side, OrderType type, double price, double stopPrice, uint64_t quantity, uint64_t peakSize, uint64_t expirySec);
-    void run();
+    // Validates on the calling thread and queues the command only if it passes;
+    // returns the rejection reason otherwise. Cancels and amends of unknown or
+    // finished orders are dropped on the engine thread.
+    const char* postOrder(OrderCommand cmd);
+    // Starts the engine thread that consumes posted orders. No-op if running.
+    void start(const EngineRunConfig& config = {});
+    // Stops and joins the engine thread. With drain=true everything already
+    // posted is processed first; otherwise it stays queued for the next start().
+    void stop(bool drain = true);
+    bool isRunning() const { return engineThread.joinable(); }
 
     // --- Methods for the CLI Tool ---
     // We add these back for direct, blocking access for the CLI.
+    // addOrder() expects an order that already passed validateOrder().
     uint64_t addOrder(OrderSide side, OrderType type, double price, double stopPrice, uint64_t quantity, uint64_t peakSize, uint64_t expirySec);
     bool cancelOrder(uint64_t orderId);
     bool modifyOrder(uint64_t orderId, double newPrice, uint64_t newQuantity);
 
+    // --- Auction Phase Control ---
+    void beginAuction();
+    std::size_t uncross();
+    TradingPhase getPhase() const;
+    AuctionIndicative getIndicativeUncross() const;
+
     // --- Common Query Methods (Thread-Safe) ---
     void printOrderBook() const;
     void printTradeHistory() const;
-    void save(const std::string& filename) const;
+    // Copies the state under the engine lock and writes it after releasing
+    // it; the caller still waits for the write.
+    void save(const std::string& filename, bool includeHistory = true) const;
+    // Same copy, but serialization and the write run on a background thread;
+    // the file is replaced atomically when complete. False if a save is
+    // already running.
+    bool saveInBackground(const std::string& filename, bool includeHistory = true);
+    SaveStatus getSaveStatus() const;
+    // Blocks until no background save is running.
+    void waitForSave();
+    // Waits for a running background save before replacing the state.
     void load(const std::string& filename);
+    void setChangeTracking(bool enabled);
+    void saveIncremental(const std::string& filename);
+    void checkpoint(const std::string& filename);
+    void setTradeLogging(bool enabled);
+    std::size_t getTradeCount() const;
+    uint64_t getTradeSequence() const;
     std::optional<Order> getOrderById(uint64_t orderId) const;
     nlohmann::json getOrderBookSnapshot() const;
     nlohmann::json getTradeHistory() const;
+    // Cached encodings of getOrderBookSnapshot()/getTradeHistory(); only
+    // re-serialized after the book/trade sequence has moved.
+    EncodedSnapshot getOrderBookEncoded() const;
+    EncodedSnapshot getTradesEncoded() const;
+    nlohmann::json getAuctionStatus() const;
+    // Best bid/offer as of the last applied command; never takes the engine lock.
+    TopOfBook getTopOfBook() const;
+    // Blocks until the top of book has a sequence other than `sequence`, or the
+    // timeout passes, and returns the latest top either way.
+    TopOfBook waitForTopOfBook(uint64_t sequence, std::chrono::milliseconds timeout) const;
+    // Bars of one configured interval with start in [fromMs, toMs], as JSON;
+    // nullopt if the interval is not configured.
+    std::optional<nlohmann::json> getBars(int64_t intervalMs, int64_t fromMs, int64_t toMs) const;
+    std::vector<int64_t> getBarIntervals() const;
+    void setBarSpecs(const std::vector<BarSpec>& specs);
+    MemoryStats getMemoryStats() const;
+    ArchiveStats getArchiveStats() const;
+    // Hardware-counter profiling of book stages. enablePerf() returns false
+    // and sets `error` if this build or host cannot open the counters.
+    bool enablePerf(std::string* error = nullptr);
+    void resetPerf();
+    // {"enabled", "stages": {<stage>: {calls, cycles, ...}}}
+    nlohmann::json getPerfStats() const;
+
+    // --- Replication ---
+    // subscribe() hands the sink a snapshot event first, then every later
+    // change; both under the engine lock, so nothing is missed or repeated.
+    // Events: snapshot, add, cancel, modify, auction, uncross; each mutating
+    // event carries the engine time "t" (ns) it was applied at.
+    void subscribe(ReplicationSink* sink);
+    void unsubscribe(ReplicationSink* sink);
+    // Replica side: replaces all state with a snapshot event's "state".
+    void loadSnapshot(const nlohmann::json& state);
 
 private:
+    void runLoop(EngineRunConfig config);
+    // Caller must hold engine_mutex.
     void processOrder(const OrderCommand& cmd);
 
+    class SnapshotCache {
+    public:
+        std::optional<EncodedSnapshot> get(uint64_t sequence) const;
+        // Keeps whichever of the stored and offered snapshots is newer.
+        EncodedSnapshot put(EncodedSnapshot snapshot);
+    private:
+        mutable std::mutex mtx;
+        EncodedSnapshot current;
+    };
+
+    // Caller must hold engine_mutex.
+    nlohmann::json orderBookJson() const;
+    // Caller must hold engine_mutex. Publishes what other threads read without
+    // it: the latest trade price (or the BBO mid before any trade) for the
+    // validator's price band, and the top of book.
+    void publishMarketState();
+
+    EncodedSnapshot makeSnapshot(char view, uint64_t sequence, std::string body) const;
+
+    // Caller must hold engine_mutex; `event` gets the current engine time.
+    void emit(nlohmann::json event);
+    void emitSnapshot(ReplicationSink* only = nullptr);
+    // Encodes snapshot events still waiting in sink queues before load()
+    // replaces the archive their copies read from.
+    void finishSnapshots();
+    // Caller must not hold engine_mutex. Writes `snapshot` as the serialize
+    // stage when `profiled`: counters are per thread, so they are read here
+    // and only the result is recorded under the lock.
+    uint64_t writeSnapshot(const BookSnapshot& snapshot, const std::string& filename, bool profiled) const;
+
+    // Upper bound on queued commands stamped by one clock read.
+    static constexpr std::size_t kMaxBatch = 64;
+
+    std::unique_ptr<EngineClock> clock;
     OrderBook orderBook;
+    OrderValidator validator;
     mutable std::mutex engine_mutex;
     ThreadSafeQueue<OrderCommand> workQueue;
+    std::thread engineThread;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> discardOnStop{false};
+
+    const uint64_t instanceId;
+    mutable SnapshotCache bookCache;
+    mutable SnapshotCache tradeCache;
+
+    std::vector<ReplicationSink*> sinks;
+    std::vector<std::weak_ptr<const SnapshotEvent>> sentSnapshots;
+
+    // Guards saveStatus and saveThread. Taken before engine_mutex, never after.
+    mutable std::mutex saveMutex;
+    SaveStatus saveStatus;
+    std::thread saveThread;
+
+    mutable std::mutex topMutex;
+    mutable std::condition_variable topChanged;
+    TopOfBook publishedTop;
 };
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "vortex/BarAggregator.h"
+#include <algorithm>
+#include <stdexcept>
+
+BarSeries::BarSeries(const BarSpec& spec) : spec(spec), ring(std::max<std::size_t>(1, spec.capacity)) {
+    if (spec.intervalMs <= 0) throw std::invalid_argument("Bar interval must be positive");
+}
+
+void BarSeries::add(double price, uint64_t quantity, int64_t timestampMs) {
+    int64_t start = timestampMs - timestampMs % spec.intervalMs;
+    if (timestampMs < 0 && start != timestampMs) start -= spec.intervalMs;
+
+    if (count > 0) {
+        Bar& current = ring[(head + count - 1) % ring.size()];
+        if (start <= current.start) {
+            current.high = std::max(current.high, price);
+            current.low = std::min(current.low, price);
+            current.close = price;
+            current.volume += quantity;
+            current.notional += price * static_cast<double>(quantity);
+            ++current.trades;
+            return;
+        }
+    }
+    // Open a new bar, overwriting the oldest once the ring is full.
+    if (count == ring.size()) head = (head + 1) % ring.size();
+    else ++count;
+    Bar& bar = ring[(head + count - 1) % ring.size()];
+    bar = Bar{start, price, price, price, price, quantity, price * static_cast<double>(quantity), 1};
+}
+
+std::vector<Bar> BarSeries::query(int64_t fromMs, int64_t toMs) const {
+    // Starts are increasing, so binary search for the first bar in range.
+    std::size_t lo = 0, hi = count;
+    while (lo < hi) {
+        std::size_t mid = (lo + hi) / 2;
+        if (at(mid).start < fromMs) lo = mid + 1; else hi = mid;
+    }
+    std::vector<Bar> bars;
+    for (std::size_t i = lo; i < count && at(i).start <= toMs; ++i) bars.push_back(at(i));
+    return bars;
+}
+
+nlohmann::json BarSeries::toJson(const std::vector<Bar>& bars, int64_t intervalMs) {
+    nlohmann::json j = nlohmann::json::array();
+    for (const Bar& b : bars) {
+        j.push_back({
+            {"start", b.start}, {"end", b.start + intervalMs},
+            {"open", b.open}, {"high", b.high}, {"low", b.low}, {"close", b.close},
+            {"volume", b.volume}, {"vwap", b.vwap()}, {"trades", b.trades}
+        });
+    }
+    return j;
+}
+
+void BarSeries::clear() {
+    head = 0;
+    count = 0;
+}
+
+std::vector<BarSpec> BarAggregator::defaultSpecs() {
+    return {{1000, 3600}, {60 * 1000, 1440}, {5 * 60 * 1000, 2016}};
+}
+
+BarAggregator::BarAggregator(const std::vector<BarSpec>& specs) {
+    series.reserve(specs.size());
+    for (const auto& spec : specs) series.emplace_back(spec);
+}
+
+void BarAggregator::onTrade(const Trade& trade) {
+    const int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(trade.timestamp.time_since_epoch()).count();
+    for (auto& s : series) s.add(trade.price, trade.quantity, ms);
+}
+
+const BarSeries* BarAggregator::find(int64_t intervalMs) const {
+    for (const auto& s : series) {
+        if (s.intervalMs() == intervalMs) return &s;
+    }
+    return nullptr;
+}
+
+void BarAggregator::clear() {
+    for (auto& s : series) s.clear();
+}
+
+int64_t parseBarInterval(const std::string& s) {
+    std::size_t used = 0;
+    long long n = 0;
+    try {
+        n = std::stoll(s, &used);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid bar interval: " + s);
+    }
+    const std::string unit = s.substr(used);
+    int64_t scale = 0;
+    if (unit.empty() || unit == "ms") scale = 1;
+    else if (unit == "s") scale = 1000;
+    else if (unit == "m") scale = 60 * 1000;
+    else if (unit == "h") scale = 60 * 60 * 1000;
+    if (scale == 0 || n <= 0) throw std::invalid_argument("Invalid bar interval: " + s);
+    return n * scale;
+}
+
+std::string formatBarInterval(int64_t intervalMs) {
+    if (intervalMs % (60 * 60 * 1000) == 0) return std::to_string(intervalMs / (60 * 60 * 1000)) + "h";
+    if (intervalMs % (60 * 1000) == 0) return std::to_string(intervalMs / (60 * 1000)) + "m";
+    if (intervalMs % 1000 == 0) return std::to_string(intervalMs / 1000) + "s";
+    return std::to_string(intervalMs) + "ms";
+}
+
+std::vector<BarSpec> parseBarSpecs(const std::string& list) {
+    const auto defaults = BarAggregator::defaultSpecs();
+    std::vector<BarSpec> specs;
+    std::size_t pos = 0;
+    while (pos <= list.size()) {
+        std::size_t next = list.find(',', pos);
+        if (next == std::string::npos) next = list.size();
+        const int64_t interval = parseBarInterval(list.substr(pos, next - pos));
+        BarSpec spec{interval, 1440};
+        for (const auto& d : defaults) {
+            if (d.intervalMs == interval) spec = d;
+        }
+        specs.push_back(spec);
+        pos = next + 1;
+    }
+    return specs;
+}
@@ -0,0 +1,114 @@
+#include "vortex/Clock.h"
+#include <ctime>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define VORTEX_HAS_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define VORTEX_HAS_TSC 1
+#endif
+
+namespace {
+int64_t wallNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+#ifdef VORTEX_HAS_TSC
+uint64_t readTsc() { return __rdtsc(); }
+
+// CPUID 0x80000007 EDX bit 8: the TSC ticks at a constant rate through
+// frequency changes and deep C-states.
+bool hasInvariantTsc() {
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0x80000000);
+    if (static_cast<unsigned>(regs[0]) < 0x80000007u) return false;
+    __cpuid(regs, 0x80000007);
+    return (regs[3] & (1 << 8)) != 0;
+#else
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx)) return false;
+    return (edx & (1u << 8)) != 0;
+#endif
+}
+#endif
+}
+
+int64_t SystemClock::nowNanos() {
+    return wallNanos();
+}
+
+MonotonicClock::MonotonicClock() : wallAnchor(wallNanos()), rawAnchor(rawNanos()) {}
+
+int64_t MonotonicClock::nowNanos() {
+    return wallAnchor + (rawNanos() - rawAnchor);
+}
+
+int64_t MonotonicClock::rawNanos() {
+#ifdef CLOCK_MONOTONIC_RAW
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+TscClock::TscClock() : wallAnchor(0), tscAnchor(0), nanosPerTick(1.0) {
+#ifdef VORTEX_HAS_TSC
+    // Calibrate over ~20ms; long enough for sub-ppm error, short enough for startup.
+    const int64_t raw0 = MonotonicClock::rawNanos();
+    const uint64_t tsc0 = readTsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const int64_t raw1 = MonotonicClock::rawNanos();
+    const uint64_t tsc1 = readTsc();
+    nanosPerTick = static_cast<double>(raw1 - raw0) / static_cast<double>(tsc1 - tsc0);
+    wallAnchor = wallNanos();
+    tscAnchor = readTsc();
+#else
+    throw std::runtime_error("TSC clock is not available on this platform");
+#endif
+}
+
+int64_t TscClock::nowNanos() {
+#ifdef VORTEX_HAS_TSC
+    return wallAnchor + static_cast<int64_t>(static_cast<double>(readTsc() - tscAnchor) * nanosPerTick);
+#else
+    return wallNanos();
+#endif
+}
+
+bool TscClock::available() {
+#ifdef VORTEX_HAS_TSC
+    static const bool invariant = hasInvariantTsc();
+    return invariant;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<EngineClock> makeClock(ClockKind kind) {
+    switch (kind) {
+        case ClockKind::Monotonic: return std::make_unique<MonotonicClock>();
+        case ClockKind::Tsc:
+            if (TscClock::available()) return std::make_unique<TscClock>();
+            return std::make_unique<MonotonicClock>();
+        case ClockKind::Simulated: return std::make_unique<SimulatedClock>(wallNanos());
+        case ClockKind::System:
+        default: return std::make_unique<SystemClock>();
+    }
+}
+
+ClockKind parseClockKind(const std::string& s) {
+    if (s == "system")    return ClockKind::System;
+    if (s == "monotonic") return ClockKind::Monotonic;
+    if (s == "tsc")       return ClockKind::Tsc;
+    if (s == "simulated") return ClockKind::Simulated;
+    throw std::invalid_argument("Invalid clock: " + s);
+}
@@ -0,0 +1,129 @@
+#include "vortex/OrderArchive.h"
+#include <cstring>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+OrderArchive::OrderArchive(std::string path) : path(std::move(path)) {
+    clear();
+}
+
+OrderArchive::OrderArchive(const OrderArchive& source, ViewTag)
+    : path(source.path), memory(source.memory), index(source.index), count(source.count), end(source.end) {
+    if (!path.empty()) {
+        reader.open(path, std::ios::binary);
+        if (!reader.is_open()) throw std::runtime_error("Could not open order archive " + path);
+    }
+}
+
+OrderArchive OrderArchive::view() const {
+    flush();
+    return OrderArchive(*this, ViewTag{});
+}
+
+void OrderArchive::flush() const {
+    if (!unflushed) return;
+    writer.flush();
+    unflushed = false;
+}
+
+void OrderArchive::clear() {
+    memory.clear();
+    index.clear();
+    count = 0;
+    end = 0;
+    unflushed = false;
+    if (!path.empty()) {
+        if (writer.is_open()) writer.close();
+        if (reader.is_open()) reader.close();
+        writer.open(path, std::ios::binary | std::ios::trunc);
+        reader.open(path, std::ios::binary);
+        if (!writer.is_open() || !reader.is_open()) {
+            throw std::runtime_error("Could not open order archive " + path);
+        }
+    }
+}
+
+void OrderArchive::append(const Order& order) {
+    std::vector<uint8_t> payload = json::to_msgpack(json(order));
+    char header[kHeaderSize];
+    const uint64_t id = order.id;
+    const uint32_t len = static_cast<uint32_t>(payload.size());
+    std::memcpy(header, &id, sizeof(id));
+    std::memcpy(header + sizeof(id), &len, sizeof(len));
+
+    if (count % kRecordsPerBlock == 0) {
+        index.push_back({id, id, end});
+    } else {
+        Block& block = index.back();
+        if (id < block.minId) block.minId = id;
+        if (id > block.maxId) block.maxId = id;
+    }
+
+    if (path.empty()) {
+        memory.append(header, kHeaderSize);
+        memory.append(reinterpret_cast<const char*>(payload.data()), payload.size());
+    } else {
+        writer.write(header, kHeaderSize);
+        writer.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+        unflushed = true;
+    }
+    ++count;
+    end += kHeaderSize + payload.size();
+}
+
+std::optional<Order> OrderArchive::find(uint64_t orderId) const {
+    std::optional<Order> result;
+    // Newest blocks first: recently retired orders are the ones looked up most.
+    for (std::size_t b = index.size(); b-- > 0 && !result; ) {
+        if (orderId < index[b].minId || orderId > index[b].maxId) continue;
+        const uint64_t blockEnd = b + 1 < index.size() ? index[b + 1].offset : end;
+        scan(index[b].offset, blockEnd, [&](uint64_t id, uint64_t payloadOffset, uint32_t len) {
+            if (id != orderId) return true;
+            std::string payload;
+            read(payloadOffset, len, payload);
+            result = decode(payload);
+            return false;
+        });
+    }
+    return result;
+}
+
+void OrderArchive::forEach(const std::function<void(const Order&)>& fn) const {
+    std::string payload;
+    scan(0, end, [&](uint64_t, uint64_t payloadOffset, uint32_t len) {
+        read(payloadOffset, len, payload);
+        fn(decode(payload));
+        return true;
+    });
+}
+
+// Walks record headers in [from, to); the callback returns false to stop.
+void OrderArchive::scan(uint64_t from, uint64_t to, const std::function<bool(uint64_t, uint64_t, uint32_t)>& fn) const {
+    std::string header;
+    for (uint64_t offset = from; offset < to; ) {
+        read(offset, kHeaderSize, header);
+        uint64_t id;
+        uint32_t len;
+        std::memcpy(&id, header.data(), sizeof(id));
+        std::memcpy(&len, header.data() + sizeof(id), sizeof(len));
+        if (!fn(id, offset + kHeaderSize, len)) return;
+        offset += kHeaderSize + len;
+    }
+}
+
+void OrderArchive::read(uint64_t offset, std::size_t len, std::string& out) const {
+    if (path.empty()) {
+        out.assign(memory, static_cast<std::size_t>(offset), len);
+        return;
+    }
+    flush();
+    out.resize(len);
+    reader.clear();
+    reader.seekg(static_cast<std::streamoff>(offset));
+    reader.read(out.data(), static_cast<std::streamsize>(len));
+}
+
+Order OrderArchive::decode(const std::string& payload) {
+    return json::from_msgpack(payload).get<Order>();
+}
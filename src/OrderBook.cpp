@@ -1,17 +1,113 @@
 #include "vortex/OrderBook.h"
 #include "vortex/Utils.h"
+#include <filesystem>
 #include <fstream>
 #include <algorithm>
 #include <iomanip>
 #include <iostream>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <fcntl.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 using json = nlohmann::json;
 
-OrderBook::OrderBook() : nextOrderId(1), nextTradeId(1) {}
+namespace {
+SystemClock defaultClock;
+
+std::unique_ptr<std::pmr::memory_resource> makePool(MemoryResourceKind kind, std::pmr::memory_resource* upstream) {
+    if (kind == MemoryResourceKind::Pool) return std::make_unique<std::pmr::unsynchronized_pool_resource>(upstream);
+    return nullptr;
+}
+
+// Flushes a file's data, or a directory's entries, to stable storage.
+bool syncToDisk(const std::string& path, bool directory) {
+#if defined(_WIN32)
+    // Windows cannot open a directory as a file; NTFS journals the rename.
+    if (directory) return true;
+    const int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0) return false;
+    const bool ok = _commit(fd) == 0;
+    _close(fd);
+#else
+    const int fd = ::open(path.c_str(), directory ? O_RDONLY | O_DIRECTORY : O_WRONLY);
+    if (fd < 0) return false;
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+#endif
+    return ok;
+}
+}
+
+OrderBook::OrderBook(MemoryResourceKind memoryKind, const std::string& archivePath)
+    : memoryKind(memoryKind),
+      heapCounter(std::pmr::new_delete_resource()),
+      pool(makePool(memoryKind, &heapCounter)),
+      bookCounter(pool ? pool.get() : &heapCounter),
+      scratch(scratchBuffer.data(), scratchBuffer.size(), &heapCounter),
+      clock(&defaultClock),
+      stampDepth(0),
+      buyOrders(&bookCounter),
+      sellOrders(&bookCounter),
+      allOrders(&bookCounter),
+      stopOrders(&bookCounter),
+      trades(&bookCounter),
+      archive(archivePath),
+      tradeLogging(true),
+      trackChanges(false),
+      dirtyOrders(&bookCounter),
+      tradesSaved(0),
+      bookSequence(0), tradeSequence(0),
+      nextOrderId(1), nextTradeId(1), journalSequence(0), phase(TradingPhase::Continuous) {}
+
+OrderBook::CommandScope::CommandScope(OrderBook& book) : book(book), heapBefore(book.heapCounter.stats()) {
+    book.pushStamp();
+}
+
+OrderBook::CommandScope::~CommandScope() {
+    book.popStamp();
+    book.scratch.release();
+    const AllocationStats& now = book.heapCounter.stats();
+    book.lastCommandHeap = {now.allocations - heapBefore.allocations,
+                            now.deallocations - heapBefore.deallocations,
+                            now.bytesAllocated - heapBefore.bytesAllocated,
+                            now.bytesInUse};
+}
+
+MemoryStats OrderBook::getMemoryStats() const {
+    return {memoryKind, bookCounter.stats(), heapCounter.stats(), lastCommandHeap};
+}
+
+void OrderBook::setClock(EngineClock* newClock) {
+    clock = newClock ? newClock : &defaultClock;
+}
+
+void OrderBook::beginBatch() { pushStamp(); }
+void OrderBook::endBatch() { popStamp(); }
+
+void OrderBook::pushStamp() {
+    if (stampDepth++ == 0) stampTime = clock->now();
+}
+
+void OrderBook::popStamp() {
+    --stampDepth;
+}
+
+std::chrono::system_clock::time_point OrderBook::currentTime() const {
+    return stampDepth > 0 ? stampTime : clock->now();
+}
 
 uint64_t OrderBook::addOrder(Order order) {
+    CommandScope scope(*this);
+    PerfScope sample(perf, PerfStage::AddOrder);
     order.id = nextOrderId++;
-    order.timestamp = Utils::now();
+    order.timestamp = currentTime();
     order.remaining = order.quantity;
     order.status = OrderStatus::Active;
     if (order.type == OrderType::Iceberg) {
@@ -20,19 +116,26 @@ uint64_t OrderBook::addOrder(Order order) {
         order.visibleQuantity = order.quantity;
     }
     addAuditTrail(order, "Order received");
-    allOrders[order.id] = order;
+    allOrders.insert(order);
     if (order.type == OrderType::Stop) {
         order.status = OrderStatus::Pending;
         stopOrders.push_back(order);
-        allOrders[order.id] = order;
-        addAuditTrail(allOrders[order.id], "Order pending (stop)");
+        addAuditTrail(allOrders.insert(order), "Order pending (stop)");
         return order.id;
     }
-    if (order.type == OrderType::FillOrKill || order.type == OrderType::ImmediateOrCancel) {
+    if (order.type == OrderType::Market || order.type == OrderType::FillOrKill ||
+        order.type == OrderType::ImmediateOrCancel) {
+        if (phase == TradingPhase::Auction) {
+            // Nothing can execute immediately during the call period.
+            allOrders.at(order.id).status = OrderStatus::Cancelled;
+            addAuditTrail(allOrders.at(order.id), "Market/IOC/FOK rejected: auction in progress");
+            retireOrder(order.id);
+            return order.id;
+        }
         matchAdvancedOrder(allOrders.at(order.id));
     } else {
         addOrderToBook(order);
-        matchOrders();
+        if (crossesTop(order)) matchOrders();
     }
     return order.id;
 }
@@ -40,90 +143,271 @@ uint64_t OrderBook::addOrder(Order order) {
 void OrderBook::addOrderToBook(Order order) {
     addAuditTrail(allOrders.at(order.id), "Order added to book");
     if (order.side == OrderSide::Buy) {
+        if (top.bidSize == 0 || order.price > top.bidPrice) setTop(order.price, order.remaining, top.askPrice, top.askSize);
+        else if (order.price == top.bidPrice) setTop(top.bidPrice, top.bidSize + order.remaining, top.askPrice, top.askSize);
         buyOrders[order.price].push_back(order);
     } else {
+        if (top.askSize == 0 || order.price < top.askPrice) setTop(top.bidPrice, top.bidSize, order.price, order.remaining);
+        else if (order.price == top.askPrice) setTop(top.bidPrice, top.bidSize, top.askPrice, top.askSize + order.remaining);
         sellOrders[order.price].push_back(order);
     }
 }
 
 void OrderBook::matchOrders() {
+    if (phase == TradingPhase::Auction) return;
+    PerfScope sample(perf, PerfStage::Match);
     while (!buyOrders.empty() && !sellOrders.empty()) {
-        auto& bestBuyLevel = buyOrders.begin()->second;
-        auto& bestSellLevel = sellOrders.begin()->second;
-        if (bestBuyLevel.front().price >= bestSellLevel.front().price) {
-            Order& buy = bestBuyLevel.front();
-            Order& sell = bestSellLevel.front();
-            uint64_t matchedQty = std::min(buy.remaining, sell.remaining);
-            double tradePrice = sell.price;
-            Trade trade{nextTradeId++, buy.id, sell.id, tradePrice, matchedQty, Utils::now()};
-            addTrade(trade);
-            buy.remaining -= matchedQty;
-            sell.remaining -= matchedQty;
-            allOrders.at(buy.id).remaining = buy.remaining;
-            allOrders.at(sell.id).remaining = sell.remaining;
-            if (buy.remaining == 0) {
-                addAuditTrail(allOrders.at(buy.id), "Order fully filled");
-                allOrders.at(buy.id).status = OrderStatus::Filled;
-                bestBuyLevel.pop_front();
-            } else {
-                addAuditTrail(allOrders.at(buy.id), "Order partially filled");
+        const Order& buy = buyOrders.begin()->second.front();
+        const Order& sell = sellOrders.begin()->second.front();
+        if (buy.price < sell.price) break;
+        executeAtTop(sell.price, std::min(buy.remaining, sell.remaining));
+    }
+}
+
+bool OrderBook::crossesTop(const Order& order) const {
+    if (order.side == OrderSide::Buy) return top.askSize > 0 && order.price >= top.askPrice;
+    return top.bidSize > 0 && order.price <= top.bidPrice;
+}
+
+namespace {
+// Sums the best level of `book`; only needed when a new level becomes best.
+template <typename Book>
+void bestLevel(const Book& book, double& price, uint64_t& size) {
+    price = 0.0;
+    size = 0;
+    if (book.empty()) return;
+    price = book.begin()->first;
+    for (const auto& o : book.begin()->second) size += o.remaining;
+}
+}
+
+void OrderBook::refreshTop() {
+    double bidPrice, askPrice;
+    uint64_t bidSize, askSize;
+    bestLevel(buyOrders, bidPrice, bidSize);
+    bestLevel(sellOrders, askPrice, askSize);
+    setTop(bidPrice, bidSize, askPrice, askSize);
+}
+
+void OrderBook::setTop(double bidPrice, uint64_t bidSize, double askPrice, uint64_t askSize) {
+    if (bidPrice == top.bidPrice && bidSize == top.bidSize && askPrice == top.askPrice && askSize == top.askSize) return;
+    top = {bidPrice, bidSize, askPrice, askSize, top.sequence + 1};
+}
+
+void to_json(json& j, const TopOfBook& top) {
+    auto side = [](double price, uint64_t size) {
+        return size > 0 ? json{{"price", price}, {"size", size}} : json(nullptr);
+    };
+    j = json{{"bid", side(top.bidPrice, top.bidSize)}, {"ask", side(top.askPrice, top.askSize)},
+             {"sequence", top.sequence}};
+}
+
+// Fills `qty` between the front orders of the best buy and sell levels at
+// `tradePrice`, retiring whatever is fully filled. The top of book follows
+// the fill, and a side is only re-summed when its best level empties.
+void OrderBook::executeAtTop(double tradePrice, uint64_t qty) {
+    auto& bestBuyLevel = buyOrders.begin()->second;
+    auto& bestSellLevel = sellOrders.begin()->second;
+    Order& buy = bestBuyLevel.front();
+    Order& sell = bestSellLevel.front();
+    const uint64_t buyId = buy.id;
+    const uint64_t sellId = sell.id;
+    Trade trade{nextTradeId++, buyId, sellId, tradePrice, qty, currentTime()};
+    addTrade(trade);
+    buy.remaining -= qty;
+    sell.remaining -= qty;
+    allOrders.at(buyId).remaining = buy.remaining;
+    allOrders.at(sellId).remaining = sell.remaining;
+    if (buy.remaining == 0) {
+        addAuditTrail(allOrders.at(buyId), "Order fully filled");
+        allOrders.at(buyId).status = OrderStatus::Filled;
+        bestBuyLevel.pop_front();
+        retireOrder(buyId);
+    } else {
+        addAuditTrail(allOrders.at(buyId), "Order partially filled");
+    }
+    if (sell.remaining == 0) {
+        addAuditTrail(allOrders.at(sellId), "Order fully filled");
+        allOrders.at(sellId).status = OrderStatus::Filled;
+        bestSellLevel.pop_front();
+        retireOrder(sellId);
+    } else {
+         addAuditTrail(allOrders.at(sellId), "Order partially filled");
+    }
+    double bidPrice = top.bidPrice, askPrice = top.askPrice;
+    uint64_t bidSize = top.bidSize - qty, askSize = top.askSize - qty;
+    if (bestBuyLevel.empty()) {
+        buyOrders.erase(buyOrders.begin());
+        bestLevel(buyOrders, bidPrice, bidSize);
+    }
+    if (bestSellLevel.empty()) {
+        sellOrders.erase(sellOrders.begin());
+        bestLevel(sellOrders, askPrice, askSize);
+    }
+    setTop(bidPrice, bidSize, askPrice, askSize);
+}
+
+void OrderBook::beginAuction() {
+    phase = TradingPhase::Auction;
+}
+
+// Single ascending pass over the union of bid and ask prices. At each
+// candidate price p the executable volume is min(bids >= p, asks <= p).
+// Ties on volume go to the smallest surplus, then to the price closest to
+// the last trade (or the lowest candidate when nothing has traded yet).
+AuctionIndicative OrderBook::getIndicativeUncross() const {
+    AuctionIndicative best;
+    if (buyOrders.empty() || sellOrders.empty()) return best;
+    if (buyOrders.begin()->first < sellOrders.begin()->first) return best;
+
+    auto levelQty = [](const std::pmr::deque<Order>& level) {
+        uint64_t qty = 0;
+        for (const auto& o : level) qty += o.remaining;
+        return qty;
+    };
+    {
+        // Bid level sizes in ascending price order, walked once; lives in scratch.
+        std::pmr::vector<uint64_t> buyLevelQty(&scratch);
+        buyLevelQty.reserve(buyOrders.size());
+        uint64_t totalBuy = 0;
+        for (auto it = buyOrders.rbegin(); it != buyOrders.rend(); ++it) {
+            buyLevelQty.push_back(levelQty(it->second));
+            totalBuy += buyLevelQty.back();
+        }
+
+        const bool hasReference = !trades.empty();
+        const double reference = hasReference ? trades.back().price : 0.0;
+        uint64_t bestSurplus = 0;
+
+        auto sellIt = sellOrders.begin();
+        auto buyIt = buyOrders.rbegin();
+        std::size_t buyIdx = 0;
+        uint64_t sellAtOrBelow = 0;
+        uint64_t buyBelow = 0;
+        while (sellIt != sellOrders.end() || buyIt != buyOrders.rend()) {
+            double p;
+            if (sellIt == sellOrders.end()) p = buyIt->first;
+            else if (buyIt == buyOrders.rend()) p = sellIt->first;
+            else p = std::min(sellIt->first, buyIt->first);
+
+            if (sellIt != sellOrders.end() && sellIt->first == p) sellAtOrBelow += levelQty((sellIt++)->second);
+            const uint64_t buyAtOrAbove = totalBuy - buyBelow;
+            if (buyIt != buyOrders.rend() && buyIt->first == p) {
+                buyBelow += buyLevelQty[buyIdx++];
+                ++buyIt;
             }
-            if (sell.remaining == 0) {
-                addAuditTrail(allOrders.at(sell.id), "Order fully filled");
-                allOrders.at(sell.id).status = OrderStatus::Filled;
-                bestSellLevel.pop_front();
-            } else {
-                 addAuditTrail(allOrders.at(sell.id), "Order partially filled");
+
+            const uint64_t volume = std::min(buyAtOrAbove, sellAtOrBelow);
+            if (volume == 0) continue;
+            const uint64_t surplus = buyAtOrAbove > sellAtOrBelow ? buyAtOrAbove - sellAtOrBelow : sellAtOrBelow - buyAtOrAbove;
+            bool better = volume > best.volume;
+            if (!better && volume == best.volume) {
+                if (surplus != bestSurplus) better = surplus < bestSurplus;
+                else if (hasReference) better = std::abs(p - reference) < std::abs(best.price - reference);
+            }
+            if (better) {
+                best = {p, volume, buyAtOrAbove, sellAtOrBelow};
+                bestSurplus = surplus;
             }
-            if (bestBuyLevel.empty()) buyOrders.erase(buyOrders.begin());
-            if (bestSellLevel.empty()) sellOrders.erase(sellOrders.begin());
-        } else {
-            break;
         }
     }
+    scratch.release();
+    return best;
 }
 
+// Executes the whole crossing volume at the equilibrium price in one step:
+// bids are consumed from the best price down and asks from the best price up,
+// each in time priority, until the equilibrium volume is exhausted.
+std::size_t OrderBook::uncross() {
+    CommandScope scope(*this);
+    const AuctionIndicative eq = getIndicativeUncross();
+    phase = TradingPhase::Continuous;
+    const std::size_t tradesBefore = trades.size();
+    uint64_t toFill = eq.volume;
+    while (toFill > 0) {
+        const Order& buy = buyOrders.begin()->second.front();
+        const Order& sell = sellOrders.begin()->second.front();
+        const uint64_t qty = std::min({toFill, buy.remaining, sell.remaining});
+        executeAtTop(eq.price, qty);
+        toFill -= qty;
+    }
+    matchOrders();
+    return trades.size() - tradesBefore;
+}
+
+// Market, IOC and FOK orders: take liquidity from the opposite side up to the
+// order's limit (market orders have none), then retire; nothing rests.
 void OrderBook::matchAdvancedOrder(Order& order) {
+    PerfScope sample(perf, PerfStage::Match);
+    const bool isBuy = order.side == OrderSide::Buy;
+    const bool hasLimit = order.type != OrderType::Market;
+    auto crosses = [&](double levelPrice) {
+        return !hasLimit || (isBuy ? levelPrice <= order.price : levelPrice >= order.price);
+    };
+
     if (order.type == OrderType::FillOrKill) {
         uint64_t fillable = 0;
-        if (order.side == OrderSide::Buy) {
-            for (auto const& [price, level] : sellOrders) {
-                 if (price <= order.price) { for(const auto& o : level) fillable += o.remaining; }
+        auto count = [&](const auto& book) {
+            for (auto it = book.begin(); it != book.end() && crosses(it->first) && fillable < order.quantity; ++it) {
+                for (const auto& o : it->second) fillable += o.remaining;
             }
-        } else {
-             for (auto const& [price, level] : buyOrders) {
-                 if (price >= order.price) { for(const auto& o : level) fillable += o.remaining; }
-            }
-        }
+        };
+        if (isBuy) count(sellOrders); else count(buyOrders);
         if (fillable < order.quantity) {
             order.status = OrderStatus::Cancelled;
             addAuditTrail(order, "FOK Cancelled: insufficient liquidity");
-            allOrders[order.id] = order;
+            retireOrder(order.id);
             return;
         }
     }
+
     uint64_t qtyToFill = order.quantity;
-    if (order.side == OrderSide::Buy) {
-        for (auto it = sellOrders.begin(); it != sellOrders.end() && qtyToFill > 0; ) {
+    // The sweep starts at the best level, so unless a level was used up the
+    // whole fill came off the top.
+    bool levelEmptied = false;
+    auto sweep = [&](auto& book) {
+        for (auto it = book.begin(); it != book.end() && qtyToFill > 0 && crosses(it->first); ) {
             auto& level = it->second;
-            for(auto orderIt = level.begin(); orderIt != level.end() && qtyToFill > 0; ) {
+            for (auto orderIt = level.begin(); orderIt != level.end() && qtyToFill > 0; ) {
                 uint64_t matchedQty = std::min(qtyToFill, orderIt->remaining);
-                Trade trade{nextTradeId++, order.id, orderIt->id, orderIt->price, matchedQty, Utils::now()};
-                addTrade(trade);
+                const uint64_t buyId = isBuy ? order.id : orderIt->id;
+                const uint64_t sellId = isBuy ? orderIt->id : order.id;
+                addTrade(Trade{nextTradeId++, buyId, sellId, orderIt->price, matchedQty, currentTime()});
                 qtyToFill -= matchedQty;
                 orderIt->remaining -= matchedQty;
                 allOrders.at(orderIt->id).remaining = orderIt->remaining;
                 if (orderIt->remaining == 0) {
-                    allOrders.at(orderIt->id).status = OrderStatus::Filled;
-                    addAuditTrail(allOrders.at(orderIt->id), "Filled by IOC/FOK order");
+                    const uint64_t filledId = orderIt->id;
+                    allOrders.at(filledId).status = OrderStatus::Filled;
+                    addAuditTrail(allOrders.at(filledId), "Filled by IOC/FOK order");
                     orderIt = level.erase(orderIt);
+                    retireOrder(filledId);
                 } else {
                     ++orderIt;
                 }
             }
-            if (level.empty()) it = sellOrders.erase(it); else ++it;
+            if (level.empty()) {
+                it = book.erase(it);
+                levelEmptied = true;
+            } else {
+                ++it;
+            }
         }
+    };
+    if (isBuy) sweep(sellOrders); else sweep(buyOrders);
+    const uint64_t swept = order.quantity - qtyToFill;
+    if (isBuy) {
+        double price = top.askPrice;
+        uint64_t size = top.askSize - swept;
+        if (levelEmptied) bestLevel(sellOrders, price, size);
+        setTop(top.bidPrice, top.bidSize, price, size);
+    } else {
+        double price = top.bidPrice;
+        uint64_t size = top.bidSize - swept;
+        if (levelEmptied) bestLevel(buyOrders, price, size);
+        setTop(price, size, top.askPrice, top.askSize);
     }
+
     order.remaining -= (order.quantity - qtyToFill);
     if (order.remaining == 0) {
         order.status = OrderStatus::Filled;
@@ -132,69 +416,239 @@ void OrderBook::matchAdvancedOrder(Order& order) {
         order.status = OrderStatus::Cancelled;
         addAuditTrail(order, "Remaining part of order cancelled (IOC/FOK)");
     }
-    allOrders[order.id] = order;
+    retireOrder(order.id);
 }
 
+// `newQuantity` is the new total, fills included, so the open quantity
+// becomes newQuantity minus what has filled; it must leave some open.
+// Same price and no more quantity: amended in place, keeping time priority.
+// Anything else is cancel-replace, which re-queues at the back of the level
+// and may trade.
 bool OrderBook::modifyOrder(uint64_t orderId, double newPrice, uint64_t newQuantity) {
-    auto it = allOrders.find(orderId);
-    if (it == allOrders.end() || it->second.status != OrderStatus::Active) return false;
-    Order originalOrder = it->second;
-    cancelOrder(orderId);
-    Order newOrder = originalOrder;
+    CommandScope scope(*this);
+    Order* existing = allOrders.find(orderId);
+    if (!existing || existing->status != OrderStatus::Active) return false;
+    const uint64_t filled = existing->quantity - existing->remaining;
+    if (newQuantity <= filled) return false;
+    if (newPrice == existing->price && newQuantity <= existing->quantity) return reduceOrder(*existing, newQuantity);
+    Order newOrder = *existing;
+    removeOrderFromBook(orderId);
     newOrder.price = newPrice;
     newOrder.quantity = newQuantity;
-    newOrder.remaining = newQuantity;
-    newOrder.timestamp = Utils::now();
+    newOrder.remaining = newQuantity - filled;
+    newOrder.visibleQuantity = std::min(newOrder.visibleQuantity, newOrder.remaining);
+    newOrder.timestamp = currentTime();
     newOrder.status = OrderStatus::Active;
     addAuditTrail(newOrder, "Order modified");
-    allOrders[orderId] = newOrder;
+    allOrders.insert(newOrder);
     addOrderToBook(newOrder);
-    matchOrders();
+    if (crossesTop(newOrder)) matchOrders();
+    return true;
+}
+
+// Lowers the total quantity of a resting order without touching its place in
+// the level. The caller has checked that some quantity stays open.
+bool OrderBook::reduceOrder(Order& order, uint64_t newQuantity) {
+    const uint64_t reduction = order.quantity - newQuantity;
+    if (reduction == 0) return true;
+    order.quantity = newQuantity;
+    order.remaining -= reduction;
+    order.visibleQuantity = std::min(order.visibleQuantity, order.remaining);
+    addAuditTrail(order, "Order amended");
+
+    auto amendLevel = [&](auto& book) {
+        auto level_it = book.find(order.price);
+        if (level_it == book.end()) return;
+        for (Order& resting : level_it->second) {
+            if (resting.id != order.id) continue;
+            resting.quantity = order.quantity;
+            resting.remaining = order.remaining;
+            resting.visibleQuantity = order.visibleQuantity;
+            return;
+        }
+    };
+    if (order.side == OrderSide::Buy) {
+        amendLevel(buyOrders);
+        if (top.bidSize > 0 && order.price == top.bidPrice)
+            setTop(top.bidPrice, top.bidSize - reduction, top.askPrice, top.askSize);
+    } else {
+        amendLevel(sellOrders);
+        if (top.askSize > 0 && order.price == top.askPrice)
+            setTop(top.bidPrice, top.bidSize, top.askPrice, top.askSize - reduction);
+    }
     return true;
 }
 
 bool OrderBook::cancelOrder(uint64_t orderId) {
-    auto it = allOrders.find(orderId);
-    if (it == allOrders.end() || (it->second.status != OrderStatus::Active && it->second.status != OrderStatus::Pending)) return false;
-    it->second.status = OrderStatus::Cancelled;
-    addAuditTrail(it->second, "Order cancelled");
-    removeOrderFromBook(orderId);
+    CommandScope scope(*this);
+    PerfScope sample(perf, PerfStage::Cancel);
+    Order* order = allOrders.find(orderId);
+    if (!order || (order->status != OrderStatus::Active && order->status != OrderStatus::Pending)) return false;
+    order->status = OrderStatus::Cancelled;
+    addAuditTrail(*order, "Order cancelled");
+    if (order->type == OrderType::Stop) {
+        stopOrders.erase(std::remove_if(stopOrders.begin(), stopOrders.end(),
+                                        [orderId](const Order& o) { return o.id == orderId; }), stopOrders.end());
+    } else {
+        removeOrderFromBook(orderId);
+    }
+    retireOrder(orderId);
     return true;
 }
 
+// Moves an order that reached a terminal state out of the hot index.
+void OrderBook::retireOrder(uint64_t orderId) {
+    const Order* order = allOrders.find(orderId);
+    if (!order) return;
+    archive.append(*order);
+    allOrders.erase(orderId);
+}
+
+std::optional<Order> OrderBook::findOrder(uint64_t orderId) const {
+    if (const Order* order = allOrders.find(orderId)) return *order;
+    return archive.find(orderId);
+}
+
 void OrderBook::removeOrderFromBook(uint64_t orderId) {
-    auto it = allOrders.find(orderId);
-    if (it == allOrders.end()) return;
-    const Order& order = it->second;
+    const Order* found = allOrders.find(orderId);
+    if (!found) return;
+    const Order& order = *found;
+    // Returns true if the order's level is now empty.
     auto removeFromBook = [&](auto& book) {
         auto level_it = book.find(order.price);
-        if (level_it != book.end()) {
-            auto& level = level_it->second;
-            level.erase(std::remove_if(level.begin(), level.end(), [orderId](const Order& o) { return o.id == orderId; }), level.end());
-            if (level.empty()) book.erase(level_it);
-        }
+        if (level_it == book.end()) return false;
+        auto& level = level_it->second;
+        level.erase(std::remove_if(level.begin(), level.end(), [orderId](const Order& o) { return o.id == orderId; }), level.end());
+        if (!level.empty()) return false;
+        book.erase(level_it);
+        return true;
     };
-    if (order.side == OrderSide::Buy) removeFromBook(buyOrders);
-    else removeFromBook(sellOrders);
+    // Only leaving the best level moves the top of book, and only emptying it
+    // needs the next level summed.
+    if (order.side == OrderSide::Buy) {
+        const bool emptied = removeFromBook(buyOrders);
+        if (top.bidSize == 0 || order.price != top.bidPrice) return;
+        double price = top.bidPrice;
+        uint64_t size = top.bidSize - order.remaining;
+        if (emptied) bestLevel(buyOrders, price, size);
+        setTop(price, size, top.askPrice, top.askSize);
+    } else {
+        const bool emptied = removeFromBook(sellOrders);
+        if (top.askSize == 0 || order.price != top.askPrice) return;
+        double price = top.askPrice;
+        uint64_t size = top.askSize - order.remaining;
+        if (emptied) bestLevel(sellOrders, price, size);
+        setTop(top.bidPrice, top.bidSize, price, size);
+    }
 }
 
+// Every change to an order is audited, so this is also where changes are tracked.
 void OrderBook::addAuditTrail(Order& order, const std::string& action) {
-    order.auditTrail.push_back(action + " @ " + Utils::formatTime(Utils::now()));
+    ++bookSequence;
+    if (trackChanges) dirtyOrders.push_back(order.id);
+    // Built in place so the entry is allocated once, from the trail's resource.
+    char stamp[32];
+    std::size_t len = Utils::formatTime(currentTime(), stamp, sizeof(stamp));
+    auto& entry = order.auditTrail.emplace_back();
+    entry.reserve(action.size() + 3 + len);
+    entry.append(action).append(" @ ").append(stamp, len);
 }
 
 void OrderBook::addTrade(const Trade& trade) {
     trades.push_back(trade);
-    std::cout << "[TRADE EXECUTED] ID: " << trade.tradeId << ", Price: " << trade.price << ", Qty: " << trade.quantity << std::endl;
+    bars.onTrade(trade);
+    ++bookSequence;
+    ++tradeSequence;
+    if (tradeLogging) {
+        std::cout << "[TRADE EXECUTED] ID: " << trade.tradeId << ", Price: " << trade.price << ", Qty: " << trade.quantity << '\n';
+    }
 }
 
-void OrderBook::save(const std::string& filename) const {
-    std::ofstream ofs(filename);
+json OrderBook::toJson(bool includeArchive) const {
+    PerfScope sample(perf, PerfStage::Serialize);
     json j;
-    j["orders"] = allOrders;
+    json orders = json::array();
+    if (includeArchive) {
+        archive.forEach([&orders](const Order& order) { orders.push_back(json::array({order.id, order})); });
+    }
+    allOrders.forEach([&orders](const Order& order) { orders.push_back(json::array({order.id, order})); });
+    j["orders"] = std::move(orders);
     j["trades"] = trades;
     j["nextOrderId"] = nextOrderId;
     j["nextTradeId"] = nextTradeId;
-    ofs << j.dump(4);
+    j["journalSequence"] = journalSequence;
+    j["phase"] = phase;
+    // Time priority within each level; cancel-replace modifies re-queue an
+    // order under its old id, so this can differ from id order.
+    json queue = json::array();
+    for (const auto& [price, level] : buyOrders) for (const auto& o : level) queue.push_back(o.id);
+    for (const auto& [price, level] : sellOrders) for (const auto& o : level) queue.push_back(o.id);
+    j["queue"] = std::move(queue);
+    return j;
+}
+
+BookSnapshot OrderBook::snapshot(bool includeArchive) const {
+    BookSnapshot copy;
+    copy.orders.reserve(allOrders.size());
+    allOrders.forEach([&copy](const Order& order) { copy.orders.push_back(order); });
+    copy.trades.assign(trades.begin(), trades.end());
+    for (const auto& [price, level] : buyOrders) for (const auto& o : level) copy.queue.push_back(o.id);
+    for (const auto& [price, level] : sellOrders) for (const auto& o : level) copy.queue.push_back(o.id);
+    if (includeArchive) copy.archive.emplace(archive.view());
+    copy.nextOrderId = nextOrderId;
+    copy.nextTradeId = nextTradeId;
+    copy.journalSequence = journalSequence;
+    copy.phase = phase;
+    return copy;
+}
+
+void BookSnapshot::write(std::ostream& out) const {
+    out << "{\n\"nextOrderId\": " << nextOrderId << ",\n\"nextTradeId\": " << nextTradeId
+        << ",\n\"journalSequence\": " << journalSequence
+        << ",\n\"phase\": " << json(phase).dump() << ",\n\"orders\": [";
+    const char* separator = "\n";
+    auto writeOrder = [&](const Order& order) {
+        out << separator << json::array({order.id, order}).dump();
+        separator = ",\n";
+    };
+    if (archive) archive->forEach(writeOrder);
+    for (const auto& order : orders) writeOrder(order);
+    out << "\n],\n\"trades\": [";
+    separator = "\n";
+    for (const auto& trade : trades) {
+        out << separator << json(trade).dump();
+        separator = ",\n";
+    }
+    out << "\n],\n\"queue\": " << json(queue).dump() << "\n}\n";
+}
+
+uint64_t BookSnapshot::writeFile(const std::string& filename) const {
+    const std::string tmp = filename + ".tmp";
+    uint64_t bytes = 0;
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if (!ofs.is_open()) throw std::runtime_error("Could not open " + tmp);
+        write(ofs);
+        ofs.flush();
+        if (!ofs) throw std::runtime_error("Could not write " + tmp);
+        bytes = static_cast<uint64_t>(ofs.tellp());
+    }
+    // The data must be on disk before the rename is, or a crash can leave
+    // `filename` pointing at an empty or partial file.
+    if (!syncToDisk(tmp, false)) throw std::runtime_error("Could not sync " + tmp);
+    std::error_code ec;
+    std::filesystem::rename(tmp, filename, ec);
+    if (ec) throw std::runtime_error("Could not rename " + tmp + ": " + ec.message());
+    // The new file is complete either way; this only makes the rename durable.
+    std::string dir = std::filesystem::path(filename).parent_path().string();
+    if (dir.empty()) dir = ".";
+    if (!syncToDisk(dir, true)) std::cerr << "Warning: could not sync directory " << dir << std::endl;
+    return bytes;
+}
+
+void OrderBook::save(const std::string& filename, bool includeArchive) const {
+    PerfScope sample(perf, PerfStage::Serialize);
+    snapshot(includeArchive).writeFile(filename);
 }
 
 void OrderBook::load(const std::string& filename) {
@@ -203,21 +657,148 @@ void OrderBook::load(const std::string& filename) {
         std::cerr << "Error: Could not open file " << filename << std::endl;
         return;
     }
+    CommandScope scope(*this);
     json j;
     ifs >> j;
+    restoreState(j);
+
+    // Records up to the snapshot's journalSequence are already in it: the
+    // journal outlives a save to the same file, or a crash between the two
+    // steps of checkpoint(). A later record may still carry trades and
+    // retirements from before the snapshot, so those are skipped by id.
+    const uint64_t base = journalSequence;
+    const uint64_t baseTradeId = nextTradeId;
+    std::ifstream journal(filename + ".journal");
+    std::string line;
+    bool replayed = false;
+    while (std::getline(journal, line)) {
+        if (line.empty()) continue;
+        json delta = json::parse(line);
+        const uint64_t seq = delta.value("seq", uint64_t{0});
+        if (base > 0 && seq <= base) continue;
+        replayed = true;
+        journalSequence = std::max(journalSequence, seq);
+        nextOrderId = delta.at("nextOrderId").get<uint64_t>();
+        nextTradeId = delta.at("nextTradeId").get<uint64_t>();
+        phase = delta.value("phase", phase);
+        for (const auto& entry : delta.at("orders")) {
+            Order order = entry.at(1).get<Order>();
+            if (order.status == OrderStatus::Active || order.status == OrderStatus::Pending) {
+                allOrders.insert(std::move(order));
+            } else if (allOrders.find(order.id) || !archive.find(order.id)) {
+                allOrders.erase(order.id);
+                archive.append(order);
+            }
+        }
+        for (const auto& t : delta.at("trades")) {
+            Trade trade = t.get<Trade>();
+            if (trade.tradeId >= baseTradeId) trades.push_back(trade);
+        }
+    }
+    // The saved queue predates the journal; fall back to id order after a replay.
+    rebuildDerivedState(replayed ? nullptr : &j);
+}
+
+void OrderBook::loadSnapshot(const json& j) {
+    CommandScope scope(*this);
+    restoreState(j);
+    rebuildDerivedState(&j);
+}
+
+void OrderBook::restoreState(const json& j) {
+    ++bookSequence;
+    ++tradeSequence;
     allOrders.clear();
+    archive.clear();
     buyOrders.clear();
     sellOrders.clear();
     trades.clear();
     stopOrders.clear();
     nextOrderId = j.at("nextOrderId").get<uint64_t>();
     nextTradeId = j.at("nextTradeId").get<uint64_t>();
-    j.at("orders").get_to(allOrders);
+    journalSequence = j.value("journalSequence", uint64_t{0});
+    phase = j.value("phase", TradingPhase::Continuous);
+    for (const auto& entry : j.at("orders")) {
+        Order order = entry.at(1).get<Order>();
+        if (order.status == OrderStatus::Active || order.status == OrderStatus::Pending) {
+            allOrders.insert(std::move(order));
+        } else {
+            archive.append(order);
+        }
+    }
     j.at("trades").get_to(trades);
-    for(const auto& [id, order] : allOrders) {
-         if (order.status == OrderStatus::Active) addOrderToBook(order);
+}
+
+// Price levels, stops and bars are derived from the orders and trades.
+// Restored orders go back on the book without a new audit entry, in the
+// saved "queue" order when there is one and id order otherwise.
+void OrderBook::rebuildDerivedState(const json* saved) {
+    bars.clear();
+    for (const auto& t : trades) bars.onTrade(t);
+
+    auto rest = [this](const Order& order) {
+        if (order.side == OrderSide::Buy) buyOrders[order.price].push_back(order);
+        else sellOrders[order.price].push_back(order);
+    };
+    std::unordered_set<uint64_t> queued;
+    if (saved && saved->contains("queue")) {
+        for (const auto& id : saved->at("queue")) {
+            const Order* order = allOrders.find(id.get<uint64_t>());
+            if (order && order->status == OrderStatus::Active && queued.insert(order->id).second) rest(*order);
+        }
+    }
+    allOrders.forEach([&](const Order& order) {
+         if (order.status == OrderStatus::Active) {
+             if (!queued.count(order.id)) rest(order);
+         }
          else if (order.status == OrderStatus::Pending && order.type == OrderType::Stop) stopOrders.push_back(order);
+    });
+    refreshTop();
+    dirtyOrders.clear();
+    tradesSaved = trades.size();
+}
+
+void OrderBook::setBarSpecs(const std::vector<BarSpec>& specs) {
+    bars = BarAggregator(specs);
+    for (const auto& t : trades) bars.onTrade(t);
+}
+
+void OrderBook::setChangeTracking(bool enabled) {
+    trackChanges = enabled;
+    dirtyOrders.clear();
+    tradesSaved = trades.size();
+}
+
+void OrderBook::saveIncremental(const std::string& filename) {
+    PerfScope sample(perf, PerfStage::Serialize);
+    std::sort(dirtyOrders.begin(), dirtyOrders.end());
+    dirtyOrders.erase(std::unique(dirtyOrders.begin(), dirtyOrders.end()), dirtyOrders.end());
+    json delta;
+    delta["seq"] = ++journalSequence;
+    json orders = json::array();
+    for (uint64_t id : dirtyOrders) {
+        if (auto order = findOrder(id)) orders.push_back(json::array({id, *order}));
     }
+    json newTrades = json::array();
+    for (std::size_t i = tradesSaved; i < trades.size(); ++i) newTrades.push_back(trades[i]);
+    delta["orders"] = std::move(orders);
+    delta["trades"] = std::move(newTrades);
+    delta["nextOrderId"] = nextOrderId;
+    delta["nextTradeId"] = nextTradeId;
+    delta["phase"] = phase;
+    std::ofstream ofs(filename + ".journal", std::ios::app);
+    ofs << delta.dump() << '\n';
+    ofs.flush();
+    if (!ofs) throw std::runtime_error("Could not append to " + filename + ".journal");
+    dirtyOrders.clear();
+    tradesSaved = trades.size();
+}
+
+void OrderBook::checkpoint(const std::string& filename) {
+    save(filename);
+    std::ofstream(filename + ".journal", std::ios::trunc);
+    dirtyOrders.clear();
+    tradesSaved = trades.size();
 }
 
 void OrderBook::printOrderBook() const {
@@ -0,0 +1,219 @@
+#include "vortex/OrderParser.h"
+#include <charconv>
+#include <cmath>
+
+namespace {
+
+// Cursor over the request body. Every method leaves `p` just past what it consumed.
+struct Scanner {
+    const char* p;
+    const char* end;
+
+    void skipWs() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+    }
+
+    bool consume(char c) {
+        skipWs();
+        if (p < end && *p == c) { ++p; return true; }
+        return false;
+    }
+
+    // Returns the raw (still escaped) contents of a string literal.
+    bool string(std::string_view& out) {
+        skipWs();
+        if (p >= end || *p != '"') return false;
+        const char* start = ++p;
+        while (p < end && *p != '"') {
+            if (*p == '\\' && ++p == end) return false;
+            ++p;
+        }
+        if (p >= end) return false;
+        out = std::string_view(start, static_cast<std::size_t>(p - start));
+        ++p;
+        return true;
+    }
+
+    // A JSON number with no fraction or exponent that fits in uint64_t.
+    bool unsignedInt(uint64_t& out) {
+        skipWs();
+        auto [ptr, ec] = std::from_chars(p, end, out);
+        if (ec != std::errc() || ptr == p) return false;
+        if (ptr < end && (*ptr == '.' || *ptr == 'e' || *ptr == 'E')) return false;
+        p = ptr;
+        return true;
+    }
+
+    bool number(double& out) {
+        skipWs();
+        // from_chars also takes "inf"/"nan", which JSON does not allow.
+        if (p >= end || !(*p == '-' || (*p >= '0' && *p <= '9'))) return false;
+        auto [ptr, ec] = std::from_chars(p, end, out);
+        if (ec != std::errc()) return false;
+        p = ptr;
+        return true;
+    }
+
+    bool literal(std::string_view word) {
+        if (static_cast<std::size_t>(end - p) < word.size() || std::string_view(p, word.size()) != word) return false;
+        p += word.size();
+        return true;
+    }
+
+    // Skips any value, including nested objects and arrays.
+    bool skipValue(int depth = 0) {
+        if (depth > 32) return false;
+        skipWs();
+        if (p >= end) return false;
+        std::string_view ignored;
+        switch (*p) {
+            case '"': return string(ignored);
+            case 't': return literal("true");
+            case 'f': return literal("false");
+            case 'n': return literal("null");
+            case '{': {
+                ++p;
+                if (consume('}')) return true;
+                do {
+                    if (!string(ignored) || !consume(':') || !skipValue(depth + 1)) return false;
+                } while (consume(','));
+                return consume('}');
+            }
+            case '[': {
+                ++p;
+                if (consume(']')) return true;
+                do {
+                    if (!skipValue(depth + 1)) return false;
+                } while (consume(','));
+                return consume(']');
+            }
+            default: {
+                double ignoredNumber;
+                return number(ignoredNumber);
+            }
+        }
+    }
+};
+
+bool parseSide(std::string_view s, OrderSide& out) {
+    if (s == "buy")  { out = OrderSide::Buy;  return true; }
+    if (s == "sell") { out = OrderSide::Sell; return true; }
+    return false;
+}
+
+bool parseType(std::string_view s, OrderType& out) {
+    if (s == "limit")   { out = OrderType::Limit;   return true; }
+    if (s == "market")  { out = OrderType::Market;  return true; }
+    if (s == "stop")    { out = OrderType::Stop;    return true; }
+    if (s == "iceberg") { out = OrderType::Iceberg; return true; }
+    if (s == "fok")     { out = OrderType::FillOrKill;        return true; }
+    if (s == "ioc")     { out = OrderType::ImmediateOrCancel; return true; }
+    return false;
+}
+
+}
+
+const char* parseOrderCommand(std::string_view body, OrderCommand& out) {
+    Scanner in{body.data(), body.data() + body.size()};
+    bool hasSide = false, hasType = false, hasQuantity = false;
+    out.price = 0.0;
+    out.stopPrice = 0.0;
+    out.peakSize = 0;
+    out.expirySec = 0;
+
+    if (!in.consume('{')) return "expected a JSON object";
+    if (!in.consume('}')) {
+        do {
+            std::string_view key, text;
+            if (!in.string(key)) return "expected a field name";
+            if (!in.consume(':')) return "expected ':' after field name";
+            if (key == "side") {
+                if (!in.string(text)) return "'side' must be a string";
+                if (!parseSide(text, out.side)) return "'side' must be one of buy|sell";
+                hasSide = true;
+            } else if (key == "type") {
+                if (!in.string(text)) return "'type' must be a string";
+                if (!parseType(text, out.type)) return "'type' must be one of limit|market|stop|iceberg|fok|ioc";
+                hasType = true;
+            } else if (key == "quantity") {
+                if (!in.unsignedInt(out.quantity)) return "'quantity' must be a non-negative integer";
+                hasQuantity = true;
+            } else if (key == "price") {
+                if (!in.number(out.price) || !std::isfinite(out.price) || out.price < 0) return "'price' must be a finite number >= 0";
+            } else if (key == "stopPrice") {
+                if (!in.number(out.stopPrice) || !std::isfinite(out.stopPrice) || out.stopPrice < 0) return "'stopPrice' must be a finite number >= 0";
+            } else if (key == "peakSize") {
+                if (!in.unsignedInt(out.peakSize)) return "'peakSize' must be a non-negative integer";
+            } else if (key == "expirySec") {
+                if (!in.unsignedInt(out.expirySec)) return "'expirySec' must be a non-negative integer";
+            } else if (!in.skipValue()) {
+                return "malformed value";
+            }
+        } while (in.consume(','));
+        if (!in.consume('}')) return "expected ',' or '}'";
+    }
+    in.skipWs();
+    if (in.p != in.end) return "unexpected data after the JSON object";
+
+    if (!hasSide) return "missing field 'side'";
+    if (!hasType) return "missing field 'type'";
+    if (!hasQuantity) return "missing field 'quantity'";
+    if (out.quantity == 0) return "'quantity' must be greater than 0";
+    return nullptr;
+}
+
+const char* parseAmendCommand(std::string_view body, OrderCommand& out) {
+    Scanner in{body.data(), body.data() + body.size()};
+    bool hasPrice = false, hasQuantity = false;
+    out.kind = CommandKind::Amend;
+    out.price = 0.0;
+    out.quantity = 0;
+
+    if (!in.consume('{')) return "expected a JSON object";
+    if (!in.consume('}')) {
+        do {
+            std::string_view key;
+            if (!in.string(key)) return "expected a field name";
+            if (!in.consume(':')) return "expected ':' after field name";
+            if (key == "price") {
+                if (!in.number(out.price) || !std::isfinite(out.price) || out.price <= 0) return "'price' must be a finite number > 0";
+                hasPrice = true;
+            } else if (key == "quantity") {
+                if (!in.unsignedInt(out.quantity) || out.quantity == 0) return "'quantity' must be an integer > 0";
+                hasQuantity = true;
+            } else if (!in.skipValue()) {
+                return "malformed value";
+            }
+        } while (in.consume(','));
+        if (!in.consume('}')) return "expected ',' or '}'";
+    }
+    in.skipWs();
+    if (in.p != in.end) return "unexpected data after the JSON object";
+
+    if (!hasPrice && !hasQuantity) return "expected 'price' and/or 'quantity'";
+    return nullptr;
+}
+
+const char* parseWsAck(std::string_view body, uint64_t& received) {
+    Scanner in{body.data(), body.data() + body.size()};
+    bool hasAck = false;
+    if (!in.consume('{')) return "expected a JSON object";
+    if (!in.consume('}')) {
+        do {
+            std::string_view key;
+            if (!in.string(key)) return "expected a field name";
+            if (!in.consume(':')) return "expected ':' after field name";
+            if (key == "ack") {
+                if (!in.unsignedInt(received)) return "'ack' must be a non-negative integer";
+                hasAck = true;
+            } else if (!in.skipValue()) {
+                return "malformed value";
+            }
+        } while (in.consume(','));
+        if (!in.consume('}')) return "expected ',' or '}'";
+    }
+    in.skipWs();
+    if (in.p != in.end) return "unexpected data after the JSON object";
+    if (!hasAck) return "missing field 'ack'";
+    return nullptr;
+}
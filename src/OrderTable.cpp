@@ -0,0 +1,83 @@
+#include "vortex/OrderTable.h"
+
+OrderTable::OrderTable(std::pmr::memory_resource* resource) : resource(resource), chunks(resource) {}
+
+OrderTable::~OrderTable() {
+    clear();
+    if (spare) destroyChunk(spare);
+}
+
+Order& OrderTable::insert(Order order) {
+    const uint64_t id = order.id;
+    if (chunks.empty()) base = id - id % kChunkSize;
+    while (id < base) {
+        chunks.push_front(nullptr);
+        base -= kChunkSize;
+    }
+    const uint64_t c = (id - base) / kChunkSize;
+    while (c >= chunks.size()) chunks.push_back(nullptr);
+    if (!chunks[c]) chunks[c] = acquireChunk();
+
+    Chunk& chunk = *chunks[c];
+    const std::size_t slot = (id - base) % kChunkSize;
+    if (!chunk.live[slot]) {
+        chunk.live[slot] = true;
+        ++chunk.liveCount;
+        ++count;
+    }
+    chunk.orders[slot] = std::move(order);
+    return chunk.orders[slot];
+}
+
+bool OrderTable::erase(uint64_t id) {
+    if (!find(id)) return false;
+    const uint64_t c = (id - base) / kChunkSize;
+    Chunk& chunk = *chunks[c];
+    const std::size_t slot = (id - base) % kChunkSize;
+    // Give the audit trail's memory back now rather than when the slot is reused.
+    decltype(Order::auditTrail)(chunk.orders[slot].auditTrail.get_allocator()).swap(chunk.orders[slot].auditTrail);
+    chunk.live[slot] = false;
+    --count;
+    if (--chunk.liveCount > 0) return true;
+
+    releaseChunk(&chunk);
+    chunks[c] = nullptr;
+    while (!chunks.empty() && !chunks.front()) {
+        chunks.pop_front();
+        base += kChunkSize;
+    }
+    while (!chunks.empty() && !chunks.back()) chunks.pop_back();
+    return true;
+}
+
+void OrderTable::clear() {
+    for (Chunk* chunk : chunks) {
+        if (chunk) destroyChunk(chunk);
+    }
+    chunks.clear();
+    base = 0;
+    count = 0;
+}
+
+OrderTable::Chunk* OrderTable::acquireChunk() {
+    if (Chunk* chunk = spare) {
+        spare = nullptr;
+        return chunk;
+    }
+    std::pmr::polymorphic_allocator<Chunk> alloc(resource);
+    Chunk* chunk = alloc.allocate(1);
+    alloc.construct(chunk, resource);
+    return chunk;
+}
+
+// Only called on empty chunks, so a kept spare has every slot free.
+void OrderTable::releaseChunk(Chunk* chunk) {
+    if (!spare) spare = chunk;
+    else destroyChunk(chunk);
+}
+
+void OrderTable::destroyChunk(Chunk* chunk) {
+    std::pmr::polymorphic_allocator<Chunk> alloc(resource);
+    chunk->~Chunk();
+    alloc.deallocate(chunk, 1);
+}
@@ -0,0 +1,114 @@
+#include "vortex/OrderValidator.h"
+#include <cmath>
+#include <stdexcept>
+
+OrderValidator::OrderValidator(const ValidationLimits& limits) : limits(limits) {}
+
+const char* OrderValidator::validate(OrderCommand& cmd) const {
+    if (cmd.kind == CommandKind::Cancel) return nullptr;
+    if (cmd.kind == CommandKind::Amend) return validateAmend(cmd);
+    if (cmd.quantity == 0) return "quantity must be greater than 0";
+    if (cmd.quantity > limits.maxOrderQuantity) return "quantity exceeds the maximum order size";
+    if (limits.lotSize > 1) {
+        cmd.quantity -= cmd.quantity % limits.lotSize;
+        if (cmd.quantity == 0) return "quantity is smaller than one lot";
+    }
+    if (!std::isfinite(cmd.price) || cmd.price < 0 || !std::isfinite(cmd.stopPrice) || cmd.stopPrice < 0) {
+        return "prices must be finite and >= 0";
+    }
+    if (cmd.type != OrderType::Iceberg && cmd.peakSize != 0) return "peakSize is only valid for iceberg orders";
+    if (cmd.type != OrderType::Stop && cmd.stopPrice != 0) return "stopPrice is only valid for stop orders";
+
+    switch (cmd.type) {
+        case OrderType::Market:
+            if (cmd.price != 0) return "market orders do not take a price";
+            cmd.expirySec = 0;  // never rests, so never expires
+            return nullptr;
+        case OrderType::Stop:
+            // Triggers sit away from the market by design, so no band check.
+            if (cmd.stopPrice <= 0) return "stop orders require stopPrice > 0";
+            if (!roundPrice(cmd.stopPrice, cmd.side)) return "stopPrice rounds to zero at this tick size";
+            if (cmd.price > 0 && !roundPrice(cmd.price, cmd.side)) return "price rounds to zero at this tick size";
+            return nullptr;
+        case OrderType::Iceberg:
+            if (cmd.peakSize == 0) return "iceberg orders require peakSize > 0";
+            if (limits.lotSize > 1) cmd.peakSize -= cmd.peakSize % limits.lotSize;
+            if (cmd.peakSize == 0) return "peakSize is smaller than one lot";
+            if (cmd.peakSize > cmd.quantity) cmd.peakSize = cmd.quantity;
+            break;
+        case OrderType::FillOrKill:
+        case OrderType::ImmediateOrCancel:
+            cmd.expirySec = 0;
+            break;
+        default:
+            break;
+    }
+
+    // Limit, iceberg, FOK and IOC orders all carry a limit price.
+    if (cmd.price <= 0) return "limit price must be greater than 0";
+    if (!roundPrice(cmd.price, cmd.side)) return "price rounds to zero at this tick size";
+    if (!inBand(cmd.price)) return "price is outside the allowed band around the reference price";
+    return nullptr;
+}
+
+// The order's side is only known on the engine thread, so an amend price
+// cannot be rounded towards the client's limit and must already be on the tick.
+const char* OrderValidator::validateAmend(OrderCommand& cmd) const {
+    if (cmd.price == 0 && cmd.quantity == 0) return "amend must change price or quantity";
+    if (cmd.quantity > limits.maxOrderQuantity) return "quantity exceeds the maximum order size";
+    if (cmd.quantity > 0 && limits.lotSize > 1) {
+        cmd.quantity -= cmd.quantity % limits.lotSize;
+        if (cmd.quantity == 0) return "quantity is smaller than one lot";
+    }
+    if (cmd.price == 0) return nullptr;
+    if (!std::isfinite(cmd.price) || cmd.price < 0) return "prices must be finite and >= 0";
+    double down = cmd.price, up = cmd.price;
+    if (!roundPrice(down, OrderSide::Buy) || !roundPrice(up, OrderSide::Sell) || down != up) {
+        return "amended price must be a multiple of the tick size";
+    }
+    cmd.price = down;
+    if (!inBand(cmd.price)) return "price is outside the allowed band around the reference price";
+    return nullptr;
+}
+
+bool OrderValidator::roundPrice(double& price, OrderSide side) const {
+    if (limits.tickSize <= 0) return price > 0;
+    // The epsilon absorbs representation error, e.g. 100.10 / 0.01 = 10009.999...
+    const double ticks = price / limits.tickSize;
+    const double steps = side == OrderSide::Buy ? std::floor(ticks + 1e-9) : std::ceil(ticks - 1e-9);
+    if (steps < 1) return false;
+    // Dividing by ticks-per-unit gives the nearest double for decimal ticks
+    // (10050 / 100 == 100.5 exactly, 10050 * 0.01 is not).
+    const double perUnit = std::round(1.0 / limits.tickSize);
+    price = std::abs(perUnit * limits.tickSize - 1.0) < 1e-12 ? steps / perUnit : steps * limits.tickSize;
+    return true;
+}
+
+bool OrderValidator::inBand(double price) const {
+    const double ref = getReferencePrice();
+    if (limits.priceBand <= 0 || ref <= 0) return true;
+    return std::abs(price - ref) <= ref * limits.priceBand * (1 + 1e-9);
+}
+
+bool parseValidationArg(const std::string& arg, ValidationLimits& limits) {
+    static const char* const names[] = {"--tick-size=", "--lot-size=", "--max-order-qty=", "--price-band="};
+    std::size_t which = 0;
+    while (which < 4 && arg.rfind(names[which], 0) != 0) ++which;
+    if (which == 4) return false;
+    const std::string value = arg.substr(std::string(names[which]).size());
+    bool valid = false;
+    try {
+        std::size_t used = 0;
+        switch (which) {
+            case 0: limits.tickSize = std::stod(value, &used);         valid = limits.tickSize >= 0; break;
+            case 1: limits.lotSize = std::stoull(value, &used);         valid = limits.lotSize > 0; break;
+            case 2: limits.maxOrderQuantity = std::stoull(value, &used); valid = limits.maxOrderQuantity > 0; break;
+            case 3: limits.priceBand = std::stod(value, &used);        valid = limits.priceBand >= 0; break;
+        }
+        valid = valid && used == value.size() && value[0] != '-';
+    } catch (const std::exception&) {
+        valid = false;
+    }
+    if (!valid) throw std::invalid_argument("Invalid value for " + arg.substr(0, arg.size() - value.size() - 1));
+    return true;
+}
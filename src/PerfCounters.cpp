@@ -0,0 +1,148 @@
+#include "vortex/PerfCounters.h"
+
+#if defined(VORTEX_ENABLE_PERF) && defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* perfStageName(PerfStage stage) {
+    switch (stage) {
+        case PerfStage::AddOrder: return "addOrder";
+        case PerfStage::Match: return "match";
+        case PerfStage::Cancel: return "cancel";
+        case PerfStage::Serialize: return "serialize";
+    }
+    return "unknown";
+}
+
+namespace {
+
+#if defined(VORTEX_ENABLE_PERF) && defined(__linux__)
+
+// One group per thread, led by the cycle counter, so a single read() returns
+// all four values sampled at the same instant.
+class CounterGroup {
+public:
+    CounterGroup() {
+        static constexpr uint64_t kEvents[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                               PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (std::size_t i = 0; i < fds.size(); ++i) {
+            fds[i] = open(kEvents[i], i == 0 ? -1 : fds[0]);
+            if (fds[i] < 0) {
+                error = std::string("perf_event_open: ") + std::strerror(errno);
+                return;
+            }
+        }
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    ~CounterGroup() {
+        for (int fd : fds) if (fd >= 0) close(fd);
+    }
+
+    bool ok() const { return error.empty(); }
+    const std::string& why() const { return error; }
+
+    bool read(PerfSample& out) const {
+        struct { uint64_t nr; uint64_t timeEnabled; uint64_t timeRunning; uint64_t values[4]; } buf;
+        if (!ok() || ::read(fds[0], &buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) return false;
+        out.timeEnabled = buf.timeEnabled;
+        out.timeRunning = buf.timeRunning;
+        out.cycles = buf.values[0];
+        out.instructions = buf.values[1];
+        out.cacheMisses = buf.values[2];
+        out.branchMisses = buf.values[3];
+        return true;
+    }
+
+private:
+    static int open(uint64_t config, int groupFd) {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = groupFd < 0;
+        attr.exclude_kernel = 1;  // allowed at perf_event_paranoid 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+    }
+
+    std::array<int, 4> fds{-1, -1, -1, -1};
+    std::string error;
+};
+
+const CounterGroup& threadCounters() {
+    thread_local CounterGroup group;
+    return group;
+}
+
+#endif
+
+}
+
+bool readPerfCounters(PerfSample& out) {
+#if defined(VORTEX_ENABLE_PERF) && defined(__linux__)
+    return threadCounters().read(out);
+#else
+    (void)out;
+    return false;
+#endif
+}
+
+bool PerfProfile::enable(std::string* error) {
+#if defined(VORTEX_ENABLE_PERF) && defined(__linux__)
+    const CounterGroup& group = threadCounters();
+    if (!group.ok()) {
+        if (error) *error = group.why();
+        return false;
+    }
+    on = true;
+    return true;
+#else
+    if (error) *error = "built without VORTEX_ENABLE_PERF (Linux only)";
+    return false;
+#endif
+}
+
+// When the PMU is shared the group only counts part of the time; the deltas
+// are scaled up by enabled/running. A call during which it never ran (e.g.
+// the NMI watchdog holds a counter) has nothing to scale and is only counted.
+void PerfProfile::record(PerfStage s, const PerfSample& start, const PerfSample& end) {
+    PerfStageStats& stats = totals[static_cast<std::size_t>(s)];
+    const uint64_t running = end.timeRunning - start.timeRunning;
+    const uint64_t enabled = end.timeEnabled - start.timeEnabled;
+    if (running == 0) {
+        ++stats.unscheduled;
+        return;
+    }
+    const double scale = static_cast<double>(enabled) / static_cast<double>(running);
+    auto scaled = [scale](uint64_t from, uint64_t to) {
+        return static_cast<uint64_t>(static_cast<double>(to - from) * scale + 0.5);
+    };
+    ++stats.calls;
+    stats.total.cycles += scaled(start.cycles, end.cycles);
+    stats.total.instructions += scaled(start.instructions, end.instructions);
+    stats.total.cacheMisses += scaled(start.cacheMisses, end.cacheMisses);
+    stats.total.branchMisses += scaled(start.branchMisses, end.branchMisses);
+    stats.total.timeEnabled += enabled;
+    stats.total.timeRunning += running;
+}
+
+nlohmann::json PerfProfile::toJson() const {
+    nlohmann::json j = nlohmann::json::object();
+    for (std::size_t i = 0; i < kPerfStageCount; ++i) {
+        const PerfStageStats& s = totals[i];
+        if (s.calls == 0 && s.unscheduled == 0) continue;
+        j[perfStageName(static_cast<PerfStage>(i))] = {
+            {"calls", s.calls}, {"unscheduled", s.unscheduled},
+            {"cycles", s.total.cycles}, {"instructions", s.total.instructions},
+            {"cacheMisses", s.total.cacheMisses}, {"branchMisses", s.total.branchMisses}
+        };
+    }
+    return j;
+}
@@ -0,0 +1,249 @@
+#include "vortex/Replication.h"
+#include <iostream>
+#include <stdexcept>
+
+// --- Publisher ---
+
+ReplicationPublisher::ReplicationPublisher(MatchingEngine& engine, std::size_t maxQueued)
+    : engine(engine), maxQueued(maxQueued) {}
+
+ReplicationPublisher::~ReplicationPublisher() {
+    stop();
+}
+
+void ReplicationPublisher::start(uint16_t port, const std::string& bindAddress) {
+    if (running.load()) return;
+    listener = Net::listenTcp(port, bindAddress);
+    running.store(true);
+    acceptor = std::thread(&ReplicationPublisher::acceptLoop, this);
+}
+
+void ReplicationPublisher::stop() {
+    if (!running.exchange(false)) return;
+    acceptor.join();
+    Net::closeSocket(listener);
+    listener = Net::kInvalidSocket;
+    std::lock_guard<std::mutex> lock(followersMutex);
+    for (auto& follower : active) engine.unsubscribe(follower.get());
+    active.clear();
+}
+
+std::size_t ReplicationPublisher::followers() const {
+    std::lock_guard<std::mutex> lock(followersMutex);
+    return active.size();
+}
+
+void ReplicationPublisher::acceptLoop() {
+    while (running.load()) {
+        const Net::SocketHandle socket = Net::acceptTcp(listener, 250);
+        reap();
+        if (socket == Net::kInvalidSocket) continue;
+        auto follower = std::make_unique<Follower>(socket, maxQueued);
+        engine.subscribe(follower.get());
+        std::lock_guard<std::mutex> lock(followersMutex);
+        active.push_back(std::move(follower));
+    }
+}
+
+void ReplicationPublisher::reap() {
+    std::lock_guard<std::mutex> lock(followersMutex);
+    for (auto it = active.begin(); it != active.end();) {
+        if ((*it)->isDone()) {
+            engine.unsubscribe(it->get());
+            it = active.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+ReplicationPublisher::Follower::Follower(Net::SocketHandle socket, std::size_t maxQueued)
+    : socket(socket), maxQueued(maxQueued), sender(&Follower::sendLoop, this) {}
+
+ReplicationPublisher::Follower::~Follower() {
+    close();
+    sender.join();
+    Net::closeSocket(socket);
+}
+
+// Runs under the engine lock: only a copy and a notify.
+void ReplicationPublisher::Follower::onEvent(const std::string& line) {
+    push({line, nullptr});
+}
+
+void ReplicationPublisher::Follower::onSnapshot(std::shared_ptr<const SnapshotEvent> snapshot) {
+    push({{}, std::move(snapshot)});
+}
+
+void ReplicationPublisher::Follower::push(Entry entry) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (closed) return;
+        if (queue.size() < maxQueued) {
+            queue.push_back(std::move(entry));
+            ready.notify_one();
+            return;
+        }
+    }
+    std::cerr << "Warning: replica fell " << maxQueued << " events behind; disconnecting it" << std::endl;
+    close();
+}
+
+void ReplicationPublisher::Follower::close() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (closed) return;
+    closed = true;
+    ready.notify_one();
+    Net::shutdownSocket(socket);
+}
+
+// Everything queued since the last write goes out in one send.
+void ReplicationPublisher::Follower::sendLoop() {
+    std::deque<Entry> pending;
+    std::string buffer;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            ready.wait(lock, [this] { return closed || !queue.empty(); });
+            if (closed) break;
+            pending.swap(queue);
+        }
+        buffer.clear();
+        for (const auto& entry : pending) {
+            buffer += entry.snapshot ? entry.snapshot->line() : entry.line;
+            buffer += '\n';
+        }
+        pending.clear();
+        if (!Net::sendAll(socket, buffer.data(), buffer.size())) break;
+    }
+    done.store(true);
+}
+
+
+// --- Follower ---
+
+ReplicationFollower::ReplicationFollower(MatchingEngine& engine, SimulatedClock& clock, std::string host, uint16_t port)
+    : engine(engine), clock(clock), host(std::move(host)), port(port) {}
+
+ReplicationFollower::~ReplicationFollower() {
+    stop();
+}
+
+void ReplicationFollower::start() {
+    if (running.exchange(true)) return;
+    worker = std::thread(&ReplicationFollower::run, this);
+}
+
+void ReplicationFollower::stop() {
+    if (!running.exchange(false)) return;
+    {
+        std::lock_guard<std::mutex> lock(socketMutex);
+        if (current != Net::kInvalidSocket) Net::shutdownSocket(current);
+    }
+    worker.join();
+}
+
+void ReplicationFollower::run() {
+    bool warned = false;
+    while (running.load()) {
+        const Net::SocketHandle socket = Net::connectTcp(host, port);
+        if (socket == Net::kInvalidSocket) {
+            if (!warned) std::cerr << "Warning: cannot reach primary at " << host << ":" << port << "; retrying" << std::endl;
+            warned = true;
+            pause(std::chrono::seconds(1));
+            continue;
+        }
+        warned = false;
+        {
+            std::lock_guard<std::mutex> lock(socketMutex);
+            current = socket;
+        }
+        if (running.load()) follow(socket);
+        synced.store(false);
+        {
+            std::lock_guard<std::mutex> lock(socketMutex);
+            current = Net::kInvalidSocket;
+        }
+        Net::closeSocket(socket);
+        if (running.load()) {
+            std::cerr << "Warning: lost primary at " << host << ":" << port << "; resyncing" << std::endl;
+            pause(std::chrono::seconds(1));
+        }
+    }
+}
+
+void ReplicationFollower::follow(Net::SocketHandle socket) {
+    std::string buffer;
+    std::size_t lineStart = 0;
+    char chunk[64 * 1024];
+    for (;;) {
+        const long n = Net::receive(socket, chunk, sizeof(chunk));
+        if (n <= 0) return;
+        const std::size_t scanFrom = buffer.size();
+        buffer.append(chunk, static_cast<std::size_t>(n));
+        for (std::size_t end = buffer.find('\n', scanFrom); end != std::string::npos; end = buffer.find('\n', lineStart)) {
+            try {
+                apply(nlohmann::json::parse(buffer.begin() + lineStart, buffer.begin() + end));
+            } catch (const std::exception& e) {
+                std::cerr << "Warning: replication stream rejected: " << e.what() << std::endl;
+                return;
+            }
+            lineStart = end + 1;
+        }
+        buffer.erase(0, lineStart);
+        lineStart = 0;
+    }
+}
+
+void ReplicationFollower::apply(const nlohmann::json& event) {
+    const std::string& kind = event.at("e").get_ref<const std::string&>();
+    if (kind == "snapshot") {
+        engine.loadSnapshot(event.at("state"));
+        synced.store(true);
+        applied.fetch_add(1);
+        return;
+    }
+    if (!synced.load()) throw std::runtime_error("event before snapshot");
+
+    clock.set(event.at("t").get<int64_t>());
+    bool ok = true;
+    if (kind == "add") {
+        const uint64_t orderId = engine.addOrder(
+            event.at("side").get<OrderSide>(), event.at("type").get<OrderType>(), event.at("price").get<double>(),
+            event.at("stopPrice").get<double>(), event.at("quantity").get<uint64_t>(),
+            event.at("peakSize").get<uint64_t>(), event.at("expirySec").get<uint64_t>());
+        ok = orderId == event.at("id").get<uint64_t>();
+    } else if (kind == "cancel") {
+        ok = engine.cancelOrder(event.at("id").get<uint64_t>());
+    } else if (kind == "modify") {
+        ok = engine.modifyOrder(event.at("id").get<uint64_t>(), event.at("price").get<double>(),
+                                event.at("quantity").get<uint64_t>());
+    } else if (kind == "auction") {
+        engine.beginAuction();
+    } else if (kind == "uncross") {
+        engine.uncross();
+    } else {
+        throw std::runtime_error("unknown event '" + kind + "'");
+    }
+    if (!ok) throw std::runtime_error("replica diverged at '" + kind + "' event");
+    applied.fetch_add(1);
+}
+
+void ReplicationFollower::pause(std::chrono::milliseconds duration) const {
+    const auto until = std::chrono::steady_clock::now() + duration;
+    while (running.load() && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+
+void parseHostPort(const std::string& s, std::string& host, uint16_t& port) {
+    const auto colon = s.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == s.size()) {
+        throw std::invalid_argument("Expected host:port, got '" + s + "'");
+    }
+    const unsigned long value = std::stoul(s.substr(colon + 1));
+    if (value == 0 || value > 65535) throw std::invalid_argument("Invalid port in '" + s + "'");
+    host = s.substr(0, colon);
+    port = static_cast<uint16_t>(value);
+}
@@ -0,0 +1,142 @@
+#include "vortex/Socket.h"
+#include <stdexcept>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Net {
+
+namespace {
+
+#if defined(_WIN32)
+using NativeSocket = SOCKET;
+struct WinsockInit {
+    WinsockInit() { WSADATA data; WSAStartup(MAKEWORD(2, 2), &data); }
+    ~WinsockInit() { WSACleanup(); }
+} winsockInit;
+constexpr int kSendFlags = 0;
+#else
+using NativeSocket = int;
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;  // a vanished replica must not raise SIGPIPE
+#else
+constexpr int kSendFlags = 0;
+#endif
+#endif
+
+NativeSocket native(SocketHandle s) { return static_cast<NativeSocket>(s); }
+
+bool valid(NativeSocket s) {
+#if defined(_WIN32)
+    return s != INVALID_SOCKET;
+#else
+    return s >= 0;
+#endif
+}
+
+// Events go out one line at a time; do not hold them back for coalescing.
+void setNoDelay(NativeSocket s) {
+    int on = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+}
+
+}
+
+SocketHandle listenTcp(uint16_t port, const std::string& bindAddress) {
+    NativeSocket s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (!valid(s)) throw std::runtime_error("Could not create socket");
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, bindAddress.c_str(), &addr.sin_addr) != 1 ||
+        ::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(s, 16) != 0) {
+        closeSocket(static_cast<SocketHandle>(s));
+        throw std::runtime_error("Could not listen on " + bindAddress + ":" + std::to_string(port));
+    }
+    return static_cast<SocketHandle>(s);
+}
+
+SocketHandle acceptTcp(SocketHandle listener, int timeoutMs) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(native(listener), &readable);
+    timeval timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    if (::select(static_cast<int>(native(listener)) + 1, &readable, nullptr, nullptr, &timeout) <= 0) {
+        return kInvalidSocket;
+    }
+    NativeSocket s = ::accept(native(listener), nullptr, nullptr);
+    if (!valid(s)) return kInvalidSocket;
+    setNoDelay(s);
+    return static_cast<SocketHandle>(s);
+}
+
+SocketHandle connectTcp(const std::string& host, uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) return kInvalidSocket;
+    SocketHandle connected = kInvalidSocket;
+    for (addrinfo* ai = result; ai && connected == kInvalidSocket; ai = ai->ai_next) {
+        NativeSocket s = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (!valid(s)) continue;
+        if (::connect(s, ai->ai_addr, static_cast<int>(ai->ai_addrlen)) == 0) {
+            setNoDelay(s);
+            connected = static_cast<SocketHandle>(s);
+        } else {
+            closeSocket(static_cast<SocketHandle>(s));
+        }
+    }
+    freeaddrinfo(result);
+    return connected;
+}
+
+bool sendAll(SocketHandle socket, const char* data, std::size_t len) {
+    while (len > 0) {
+        const int chunk = len > (1u << 30) ? (1 << 30) : static_cast<int>(len);
+        const auto sent = ::send(native(socket), data, chunk, kSendFlags);
+        if (sent <= 0) return false;
+        data += sent;
+        len -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+long receive(SocketHandle socket, char* buf, std::size_t len) {
+    const int chunk = len > (1u << 30) ? (1 << 30) : static_cast<int>(len);
+    const auto n = ::recv(native(socket), buf, chunk, 0);
+    return n < 0 ? -1 : static_cast<long>(n);
+}
+
+void shutdownSocket(SocketHandle socket) {
+#if defined(_WIN32)
+    ::shutdown(native(socket), SD_BOTH);
+#else
+    ::shutdown(native(socket), SHUT_RDWR);
+#endif
+}
+
+void closeSocket(SocketHandle socket) {
+#if defined(_WIN32)
+    ::closesocket(native(socket));
+#else
+    ::close(native(socket));
+#endif
+}
+
+}
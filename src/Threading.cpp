@@ -0,0 +1,66 @@
+#include "vortex/Threading.h"
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define VORTEX_HAS_PAUSE 1
+#endif
+
+namespace Threading {
+
+bool pinCurrentThread(int cpu) {
+    if (cpu < 0 || static_cast<unsigned>(cpu) >= cpuCount()) return false;
+#if defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+bool excludeCpuFromCurrentThread(int cpu) {
+    if (cpu < 0 || static_cast<unsigned>(cpu) >= cpuCount() || cpuCount() < 2) return false;
+#if defined(_WIN32)
+    DWORD_PTR processMask = 0, systemMask = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) return false;
+    DWORD_PTR mask = processMask & ~(DWORD_PTR(1) << cpu);
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0) return false;
+    CPU_CLR(cpu, &set);
+    if (CPU_COUNT(&set) == 0) return false;
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+unsigned cpuCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+void cpuRelax() {
+#ifdef VORTEX_HAS_PAUSE
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+}
@@ -3,11 +3,19 @@
 #include <sstream>
 #include <iomanip>
 #include <ctime>
+#include <cstdio>
 
 namespace Utils {
 
 std::string formatTime(const std::chrono::system_clock::time_point& tp) {
-    if (tp == std::chrono::system_clock::time_point::min()) return "N/A";
+    char buf[32];
+    return std::string(buf, formatTime(tp, buf, sizeof(buf)));
+}
+
+std::size_t formatTime(const std::chrono::system_clock::time_point& tp, char* buf, std::size_t len) {
+    if (tp == std::chrono::system_clock::time_point::min()) {
+        return static_cast<std::size_t>(std::snprintf(buf, len, "N/A"));
+    }
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()) % 1000;
     std::time_t t = std::chrono::system_clock::to_time_t(tp);
     std::tm tm_buf;
@@ -16,10 +24,9 @@ std::string formatTime(const std::chrono::system_clock::time_point& tp) {
 #else
     localtime_r(&t, &tm_buf);
 #endif
-    std::ostringstream oss;
-    oss << std::put_time(&tm_buf, "%Y-%m-%d %H:%M:%S")
-        << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    return oss.str();
+    std::size_t n = std::strftime(buf, len, "%Y-%m-%d %H:%M:%S", &tm_buf);
+    int m = std::snprintf(buf + n, len - n, ".%03d", static_cast<int>(ms.count()));
+    return n + static_cast<std::size_t>(m > 0 ? m : 0);
 }
 
 std::chrono::system_clock::time_point parseTime(const std::string& s) {
@@ -41,6 +48,15 @@ std::chrono::system_clock::time_point now() {
     return std::chrono::system_clock::now();
 }
 
+int64_t toEpochNanos(const std::chrono::system_clock::time_point& tp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point fromEpochNanos(int64_t nanos) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(nanos)));
+}
+
 std::string orderTypeToStr(OrderType type) {
     switch (type) {
         case OrderType::Limit: return "Limit";
@@ -1,120 +1,448 @@
 #include "vortex/matching_engine.h"
 #include "vortex/Utils.h"
+#include "vortex/Threading.h"
+#include "vortex/OrderParser.h"
+#include "vortex/WsFanout.h"
+#include "vortex/BarAggregator.h"
+#include "vortex/Replication.h"
 #include <crow.h>
 #include <nlohmann/json.hpp>
+#include <cctype>
+#include <limits>
+#include <map>
+#include <condition_variable>
+#include <functional>
 #include <mutex>
+#include <memory>
+#include <string_view>
 #include <thread>
-#include <unordered_set>
 
 using json = nlohmann::json;
 using crow::request;
 using crow::response;
 using crow::SimpleApp;
 
+struct ServerConfig {
+    int port = 8080;
+    unsigned ioThreads = 0;  // 0 lets Crow pick (hardware concurrency)
+    int engineCpu = -1;      // Crow and broadcast threads are kept off this CPU
+    bool readOnly = false;   // Replicas answer every write with 403
+    std::string snapshotFile = "snapshot.json";  // Target of POST /api/v1/snapshot
+    std::function<json()> replicationStatus;  // Served at /api/v1/replication when set
+};
+
 class ApiServer {
 public:
     ApiServer(MatchingEngine& me) : engine(me) {}
 
-    void run(int port = 8080) {
+    // Blocks until Crow is stopped (SIGINT/SIGTERM), then joins the broadcaster.
+    void run(const ServerConfig& config = {}) {
+        readOnly = config.readOnly;
+        snapshotFile = config.snapshotFile;
+        replicationStatus = config.replicationStatus;
         defineRestEndpoints();
         defineWebSocketEndpoint();
+        // Threads spawned from here on inherit the reduced affinity mask.
+        if (config.engineCpu >= 0 && !Threading::excludeCpuFromCurrentThread(config.engineCpu)) {
+            std::cerr << "Warning: could not keep server threads off CPU " << config.engineCpu << std::endl;
+        }
         spawnBroadcastThread();
-        app.port(static_cast<uint16_t>(port)).multithreaded().run();
+        spawnL1Thread();
+        app.port(static_cast<uint16_t>(config.port));
+        if (config.ioThreads > 0) app.concurrency(config.ioThreads);
+        else app.multithreaded();
+        app.run();
+        stopBroadcastThread();
     }
 
 private:
     SimpleApp app;
     MatchingEngine& engine; // Use a reference to the main engine
+    bool readOnly = false;
+    std::string snapshotFile;
+    std::function<json()> replicationStatus;
 
-    std::mutex ws_mtx;
-    std::unordered_set<crow::websocket::connection*> ws_clients;
+    std::thread broadcaster;
+    std::mutex broadcast_mtx;
+    std::condition_variable broadcast_cv;
+    bool stopping = false;
+
+    WsFanout<crow::websocket::connection> marketData;
+    WsFanout<crow::websocket::connection> barData;
+    WsFanout<crow::websocket::connection> l1Data;
+    std::thread l1Publisher;
 
     void defineRestEndpoints() {
         CROW_ROUTE(app, "/api/v1/orders").methods("POST"_method)
         ([this](const request& req) {
+            if (readOnly) return readOnlyResponse();
             try {
-                auto j = json::parse(req.body);
-                auto side      = j.at("side").get<OrderSide>();
-                auto type      = j.at("type").get<OrderType>();
-                double price   = j.value("price", 0.0);
-                double stopP   = j.value("stopPrice", 0.0);
-                auto qty       = j.at("quantity").get<uint64_t>();
-                auto peak      = j.value("peakSize", 0ULL);
-                auto expiry    = j.value("expirySec", 0ULL);
+                // Scanned in place; no DOM is built for the hot order-entry path.
+                OrderCommand cmd;
+                if (const char* error = parseOrderCommand(req.body, cmd)) {
+                    return response{400, json{{"error", std::string("JSON Parsing Error: ") + error}}.dump()};
+                }
                 
-                // Post the work to the queue instead of processing it here
-                engine.postOrder(side, type, price, stopP, qty, peak, expiry);
+                // Validated here, on the I/O thread; only accepted orders are queued.
+                if (const char* rejection = engine.postOrder(cmd)) {
+                    return response{422, json{{"error", std::string("Order rejected: ") + rejection}}.dump()};
+                }
                 
                 // Respond immediately
-                return response{202, json{{"status", "accepted"}}.dump()};
-            }
-            catch (const json::exception& e) {
-                return response{400, json{{"error", std::string("JSON Parsing Error: ") + e.what()}}.dump()};
+                return response{202, R"({"status":"accepted"})"};
             }
             catch (const std::exception& ex) {
                 return response{500, json{{"error", ex.what()}}.dump()};
             }
         });
 
-        // Other GET routes remain the same as they are read-only
-        CROW_ROUTE(app, "/api/v1/orders/<uint>")
-        ([this](uint64_t id) {
-            auto ord = engine.getOrderById(id);
-            if (!ord) return response{404, R"({"error":"Order not found"})"};
-            json j = *ord;
-            return response{j.dump()};
+        // PATCH amends and DELETE cancels through the same queue as new
+        // orders, so they apply in arrival order; an order that is gone by
+        // then is left alone. The quantity is the new total including fills,
+        // and an amend to or below the filled quantity is ignored. A smaller
+        // quantity at the same price keeps the order's place in its level.
+        CROW_ROUTE(app, "/api/v1/orders/<uint>").methods("GET"_method, "PATCH"_method, "DELETE"_method)
+        ([this](const request& req, uint64_t id) {
+            if (req.method == "GET"_method) {
+                auto ord = engine.getOrderById(id);
+                if (!ord) return response{404, R"({"error":"Order not found"})"};
+                json j = *ord;
+                return response{j.dump()};
+            }
+            if (readOnly) return readOnlyResponse();
+            OrderCommand cmd;
+            cmd.kind = CommandKind::Cancel;
+            if (req.method == "PATCH"_method) {
+                if (const char* error = parseAmendCommand(req.body, cmd)) {
+                    return response{400, json{{"error", std::string("JSON Parsing Error: ") + error}}.dump()};
+                }
+            }
+            cmd.orderId = id;
+            if (const char* rejection = engine.postOrder(cmd)) {
+                return response{422, json{{"error", std::string("Amend rejected: ") + rejection}}.dump()};
+            }
+            return response{202, R"({"status":"accepted"})"};
         });
+        // Served from the engine's per-sequence cache; pollers that send back
+        // the ETag get 304 until the book or trade list actually changes.
         CROW_ROUTE(app, "/api/v1/orderbook")
-        ([this] { return response{engine.getOrderBookSnapshot().dump()}; });
+        ([this](const request& req) { return cachedResponse(req, engine.getOrderBookEncoded()); });
         CROW_ROUTE(app, "/api/v1/trades")
-        ([this] { return response{engine.getTradeHistory().dump()}; });
+        ([this](const request& req) { return cachedResponse(req, engine.getTradesEncoded()); });
+
+        // Read from the engine's published copy; does not touch the book.
+        CROW_ROUTE(app, "/api/v1/bbo")
+        ([this] { return response{json(engine.getTopOfBook()).dump()}; });
+
+        CROW_ROUTE(app, "/api/v1/bars")
+        ([this](const request& req) {
+            try {
+                const char* interval = req.url_params.get("interval");
+                const char* from = req.url_params.get("from");
+                const char* to = req.url_params.get("to");
+                const int64_t intervalMs = parseBarInterval(interval ? interval : "1m");
+                const int64_t fromMs = from ? std::stoll(from) : std::numeric_limits<int64_t>::min();
+                const int64_t toMs = to ? std::stoll(to) : std::numeric_limits<int64_t>::max();
+                auto bars = engine.getBars(intervalMs, fromMs, toMs);
+                if (!bars) {
+                    json available = json::array();
+                    for (int64_t ms : engine.getBarIntervals()) available.push_back(formatBarInterval(ms));
+                    return response{400, json{{"error", "Interval not configured"}, {"intervals", available}}.dump()};
+                }
+                return response{json{{"interval", formatBarInterval(intervalMs)}, {"bars", std::move(*bars)}}.dump()};
+            } catch (const std::exception& ex) {
+                return response{400, json{{"error", ex.what()}}.dump()};
+            }
+        });
+
+        CROW_ROUTE(app, "/api/v1/stats")
+        ([this] {
+            return response{json{{"memory", engine.getMemoryStats()}, {"archive", engine.getArchiveStats()},
+                                 {"perf", engine.getPerfStats()}}.dump()};
+        });
+
+        CROW_ROUTE(app, "/api/v1/auction")
+        ([this] { return response{engine.getAuctionStatus().dump()}; });
+        CROW_ROUTE(app, "/api/v1/auction/start").methods("POST"_method)
+        ([this] {
+            if (readOnly) return readOnlyResponse();
+            engine.beginAuction();
+            return response{engine.getAuctionStatus().dump()};
+        });
+        CROW_ROUTE(app, "/api/v1/auction/uncross").methods("POST"_method)
+        ([this] {
+            if (readOnly) return readOnlyResponse();
+            std::size_t executed = engine.uncross();
+            return response{json{{"status", "uncrossed"}, {"trades", executed}}.dump()};
+        });
+
+        // Persisting does not change the book, so replicas may snapshot too.
+        CROW_ROUTE(app, "/api/v1/snapshot").methods("POST"_method)
+        ([this] {
+            if (!engine.saveInBackground(snapshotFile)) {
+                return response{409, json{{"error", "A snapshot is already being written"}, {"status", engine.getSaveStatus()}}.dump()};
+            }
+            return response{202, json{{"status", engine.getSaveStatus()}}.dump()};
+        });
+        CROW_ROUTE(app, "/api/v1/snapshot/status")
+        ([this] { return response{json(engine.getSaveStatus()).dump()}; });
+
+        CROW_ROUTE(app, "/api/v1/replication")
+        ([this] {
+            if (!replicationStatus) return response{404, R"({"error":"Replication not enabled"})"};
+            return response{replicationStatus().dump()};
+        });
+    }
+
+    static response readOnlyResponse() {
+        return response{403, R"({"error":"Read-only replica; send writes to the primary"})"};
+    }
+
+    static bool etagMatches(const std::string& ifNoneMatch, const std::string& etag) {
+        if (ifNoneMatch.empty()) return false;
+        if (ifNoneMatch == "*") return true;
+        // A comma-separated list; weak tags compare equal to their strong form.
+        std::size_t pos = 0;
+        while (pos < ifNoneMatch.size()) {
+            std::size_t next = ifNoneMatch.find(',', pos);
+            if (next == std::string::npos) next = ifNoneMatch.size();
+            std::size_t b = ifNoneMatch.find_first_not_of(" \t", pos);
+            std::size_t e = ifNoneMatch.find_last_not_of(" \t", next - 1);
+            if (b != std::string::npos && b < next && e != std::string::npos && e >= b) {
+                std::string_view tag(ifNoneMatch.data() + b, e - b + 1);
+                if (tag.substr(0, 2) == "W/") tag.remove_prefix(2);
+                if (tag == etag) return true;
+            }
+            pos = next + 1;
+        }
+        return false;
+    }
+
+    static response cachedResponse(const request& req, const EncodedSnapshot& snapshot) {
+        response res;
+        if (etagMatches(req.get_header_value("If-None-Match"), snapshot.etag)) {
+            res.code = 304;
+        } else {
+            res.body = *snapshot.body;
+            res.set_header("Content-Type", "application/json");
+        }
+        res.set_header("ETag", snapshot.etag);
+        res.set_header("Cache-Control", "no-cache");
+        return res;
+    }
+
+    // Crow reports nothing about socket writes, so subscribers acknowledge
+    // what they have received and are throttled on that. Anything else a
+    // client sends is ignored.
+    static void onAck(WsFanout<crow::websocket::connection>& fanout, crow::websocket::connection& c,
+                      const std::string& message) {
+        uint64_t received = 0;
+        if (!parseWsAck(message, received)) fanout.ack(c, received);
     }
 
     void defineWebSocketEndpoint() {
         CROW_ROUTE(app, "/api/v1/ws").websocket(&app)
-        .onopen([this](crow::websocket::connection& c) {
-            std::lock_guard lk(ws_mtx);
-            ws_clients.insert(&c);
-        })
-        .onclose([this](crow::websocket::connection& c, const std::string&, uint16_t) {
-            std::lock_guard lk(ws_mtx);
-            ws_clients.erase(&c);
-        })
-        .onmessage([](crow::websocket::connection&, const std::string&, bool) {});
+        .onopen([this](crow::websocket::connection& c) { marketData.add(c); })
+        .onclose([this](crow::websocket::connection& c, const std::string&, uint16_t) { marketData.remove(c); })
+        .onmessage([this](crow::websocket::connection& c, const std::string& m, bool) { onAck(marketData, c, m); });
+
+        CROW_ROUTE(app, "/api/v1/ws/bars").websocket(&app)
+        .onopen([this](crow::websocket::connection& c) { barData.add(c); })
+        .onclose([this](crow::websocket::connection& c, const std::string&, uint16_t) { barData.remove(c); })
+        .onmessage([this](crow::websocket::connection& c, const std::string& m, bool) { onAck(barData, c, m); });
+
+        CROW_ROUTE(app, "/api/v1/ws/l1").websocket(&app)
+        .onopen([this](crow::websocket::connection& c) { l1Data.add(c); })
+        .onclose([this](crow::websocket::connection& c, const std::string&, uint16_t) { l1Data.remove(c); })
+        .onmessage([this](crow::websocket::connection& c, const std::string& m, bool) { onAck(l1Data, c, m); });
+    }
+
+    // Pushes the top of book as soon as it changes rather than on the
+    // once-a-second snapshot tick. A subscriber that falls behind only gets
+    // the latest top.
+    void spawnL1Thread() {
+        l1Publisher = std::thread([this] {
+            uint64_t sequence = engine.getTopOfBook().sequence;
+            for (;;) {
+                {
+                    std::lock_guard lk(broadcast_mtx);
+                    if (stopping) return;
+                }
+                TopOfBook top = engine.waitForTopOfBook(sequence, std::chrono::milliseconds(250));
+                if (top.sequence == sequence) continue;
+                sequence = top.sequence;
+                json update = top;
+                update["type"] = "l1";
+                l1Data.publish(std::make_shared<const std::string>(update.dump()));
+            }
+        });
     }
 
     void spawnBroadcastThread() {
-        std::thread([this] {
+        broadcaster = std::thread([this] {
+            std::shared_ptr<const std::string> message;
+            EncodedSnapshot book, trades;
+            BarCursor bars;
             while (true) {
-                std::this_thread::sleep_for(std::chrono::seconds(1));
-                auto payload = json{
-                    {"type", "snapshot"},
-                    {"orderBook", engine.getOrderBookSnapshot()},
-                    {"trades",    engine.getTradeHistory()}
-                };
-                auto msg = payload.dump();
-                std::lock_guard lk(ws_mtx);
-                for (auto* c : ws_clients) {
-                    if (c) c->send_text(msg);
+                {
+                    std::unique_lock lk(broadcast_mtx);
+                    if (broadcast_cv.wait_for(lk, std::chrono::seconds(1), [this] { return stopping; })) return;
                 }
+                EncodedSnapshot nextBook = engine.getOrderBookEncoded();
+                EncodedSnapshot nextTrades = engine.getTradesEncoded();
+                // Spliced from the same cached bytes the REST routes serve; the
+                // frame is only rebuilt when one of them has changed.
+                if (!message || nextBook.body != book.body || nextTrades.body != trades.body) {
+                    book = std::move(nextBook);
+                    trades = std::move(nextTrades);
+                    std::string payload;
+                    payload.reserve(book.body->size() + trades.body->size() + 48);
+                    payload.append(R"({"orderBook":)").append(*book.body)
+                           .append(R"(,"trades":)").append(*trades.body)
+                           .append(R"(,"type":"snapshot"})");
+                    message = std::make_shared<const std::string>(std::move(payload));
+                }
+                // Shared by every subscriber's queue.
+                marketData.publish(message);
+                publishBars(bars);
             }
-        }).detach();
+        });
+    }
+
+    // Per interval, the start of the newest bar already sent.
+    struct BarCursor {
+        uint64_t tradeSequence = 0;
+        std::map<int64_t, int64_t> lastStart;
+    };
+
+    // Sends, for each interval, the last bar already sent (now possibly final)
+    // plus any newer ones; nothing is sent until a trade has printed. These
+    // are deltas, so they are never conflated or dropped: a subscriber that
+    // cannot keep up is disconnected instead.
+    void publishBars(BarCursor& cursor) {
+        const uint64_t sequence = engine.getTradeSequence();
+        if (sequence == cursor.tradeSequence) return;
+        cursor.tradeSequence = sequence;
+        for (int64_t interval : engine.getBarIntervals()) {
+            auto [it, inserted] = cursor.lastStart.try_emplace(interval, std::numeric_limits<int64_t>::min());
+            auto bars = engine.getBars(interval, it->second, std::numeric_limits<int64_t>::max());
+            if (!bars || bars->empty()) continue;
+            it->second = bars->back().at("start").get<int64_t>();
+            json update{{"type", "bars"}, {"interval", formatBarInterval(interval)}, {"bars", std::move(*bars)}};
+            barData.publish(std::make_shared<const std::string>(update.dump()), false);
+        }
+    }
+
+    void stopBroadcastThread() {
+        {
+            std::lock_guard lk(broadcast_mtx);
+            stopping = true;
+        }
+        broadcast_cv.notify_all();
+        if (broadcaster.joinable()) broadcaster.join();
+        if (l1Publisher.joinable()) l1Publisher.join();
     }
 };
 
+void printUsage() {
+    std::cerr << "Usage: vortex_api_server [port] [--memory=global|pool] [--archive=<file>]\n"
+              << "                         [--clock=system|monotonic|tsc] [--engine-cpu=<n>]\n"
+              << "                         [--busy-poll] [--io-threads=<n>] [--perf]\n"
+              << "                         [--tick-size=<x>] [--lot-size=<n>] [--max-order-qty=<n>] [--price-band=<fraction>]\n"
+              << "                         [--bars=<interval,...>] [--snapshot-file=<file>]\n"
+              << "                         [--replication-port=<n> | --replica-of=<host:port>]\n";
+}
+
 int main(int argc, char* argv[]) {
     try {
+        ServerConfig serverConfig;
+        EngineRunConfig runConfig;
+        MemoryResourceKind memoryKind = MemoryResourceKind::Pool;
+        std::string archivePath;
+        ClockKind clockKind = ClockKind::System;
+        ValidationLimits limits;
+        std::vector<BarSpec> barSpecs = BarAggregator::defaultSpecs();
+        int replicationPort = 0;
+        std::string primaryHost;
+        uint16_t primaryPort = 0;
+        bool perf = false;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (parseValidationArg(arg, limits)) continue;
+            if (arg == "--memory=global") memoryKind = MemoryResourceKind::Global;
+            else if (arg == "--memory=pool") memoryKind = MemoryResourceKind::Pool;
+            else if (arg.rfind("--archive=", 0) == 0) archivePath = arg.substr(10);
+            else if (arg.rfind("--clock=", 0) == 0) clockKind = parseClockKind(arg.substr(8));
+            else if (arg.rfind("--engine-cpu=", 0) == 0) runConfig.cpu = std::stoi(arg.substr(13));
+            else if (arg == "--busy-poll") runConfig.busyPoll = true;
+            else if (arg == "--perf") perf = true;
+            else if (arg.rfind("--bars=", 0) == 0) barSpecs = parseBarSpecs(arg.substr(7));
+            else if (arg.rfind("--snapshot-file=", 0) == 0) serverConfig.snapshotFile = arg.substr(16);
+            else if (arg.rfind("--replication-port=", 0) == 0) replicationPort = std::stoi(arg.substr(19));
+            else if (arg.rfind("--replica-of=", 0) == 0) parseHostPort(arg.substr(13), primaryHost, primaryPort);
+            else if (arg.rfind("--io-threads=", 0) == 0) serverConfig.ioThreads = static_cast<unsigned>(std::stoul(arg.substr(13)));
+            else if (!arg.empty() && std::isdigit(static_cast<unsigned char>(arg[0]))) serverConfig.port = std::stoi(arg);
+            else {
+                printUsage();
+                return 1;
+            }
+        }
+        if (replicationPort > 0 && primaryPort > 0) {
+            printUsage();
+            return 1;
+        }
+        serverConfig.engineCpu = runConfig.cpu;
+
         // Create a single matching engine
-        MatchingEngine engine;
+        MatchingEngine engine(memoryKind, archivePath);
+        engine.setValidationLimits(limits);
+        engine.setBarSpecs(barSpecs);
+        std::string perfError;
+        if (perf && !engine.enablePerf(&perfError)) {
+            std::cerr << "Warning: hardware counters unavailable (" << perfError << "); continuing without --perf" << std::endl;
+        }
+
+        if (primaryPort > 0) {
+            // Read replica: state arrives from the primary and is replayed at
+            // the primary's timestamps, so no engine thread and no local clock.
+            auto replayClock = std::make_unique<SimulatedClock>();
+            ReplicationFollower follower(engine, *replayClock, primaryHost, primaryPort);
+            engine.setClock(std::move(replayClock));
+            follower.start();
+            serverConfig.readOnly = true;
+            serverConfig.replicationStatus = [&] {
+                return json{{"role", "replica"}, {"primary", primaryHost + ":" + std::to_string(primaryPort)},
+                            {"synced", follower.isSynced()}, {"eventsApplied", follower.eventsApplied()}};
+            };
+            ApiServer server(engine);
+            server.run(serverConfig);
+            follower.stop();
+            return 0;
+        }
+
+        if (clockKind == ClockKind::Tsc && !TscClock::available()) {
+            std::cerr << "Warning: no invariant TSC; using the monotonic clock" << std::endl;
+        }
+        engine.setClock(makeClock(clockKind));
         // Start its dedicated processing thread
-        engine.run();
+        engine.start(runConfig);
+
+        std::unique_ptr<ReplicationPublisher> publisher;
+        if (replicationPort > 0) {
+            publisher = std::make_unique<ReplicationPublisher>(engine);
+            publisher->start(static_cast<uint16_t>(replicationPort));
+            serverConfig.replicationStatus = [&] {
+                return json{{"role", "primary"}, {"port", replicationPort}, {"followers", publisher->followers()}};
+            };
+        }
 
         // Pass a reference to the engine to the API server
         ApiServer server(engine);
-        
-        int port = 8080;
-        if (argc > 1) port = std::stoi(argv[1]);
-        server.run(port);
+        server.run(serverConfig);
+
+        // Crow has stopped accepting requests; finish what was already accepted.
+        engine.stop(true);
+        if (publisher) publisher->stop();
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
         return 1;
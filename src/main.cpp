@@ -6,6 +6,8 @@
 #include <string>
 #include <iomanip>
 #include <chrono>
+#include <fstream>
+#include <limits>
 
 // Helper: print available commands
 void printHelp() {
@@ -19,12 +21,17 @@ void printHelp() {
     std::cout << "      stopPrice: stop trigger price (required for stop, else 0)\n";
     std::cout << "      expiry: optional expiry time (YYYY-MM-DDTHH:MM)\n";
     std::cout << "  cancel <orderId>\n";
-    std::cout << "  modify <orderId> <new_price> <new_quantity>\n";
+    std::cout << "  modify <orderId> <new_price> <new_quantity>   (total incl. filled; smaller size, same price keeps priority)\n";
+    std::cout << "  auction start|uncross|status\n";
     std::cout << "  book\n";
     std::cout << "  trades\n";
-    std::cout << "  save <filename>\n";
+    std::cout << "  stats [reset]\n";
+    std::cout << "  bars <1s|1m|5m> [count]\n";
+    std::cout << "  save <filename> [--no-history]\n";
+    std::cout << "  bgsave <filename> [--no-history]\n";
+    std::cout << "  savestatus\n";
     std::cout << "  load <filename>\n";
-    std::cout << "  autosave on|off\n";
+    std::cout << "  autosave on [every <n>] [interval <ms>] [file <name>] | off\n";
     std::cout << "  help\n";
     std::cout << "  quit\n";
 }
@@ -51,6 +58,39 @@ std::string toLower(const std::string& s) {
     return out;
 }
 
+// Throttled autosave. Enabling it writes a full snapshot; after that, every
+// `everyCommands` mutating commands or `interval` (whichever comes first) only
+// the changes since the previous save are appended to "<file>.journal".
+struct Autosave {
+    static constexpr uint64_t kCompactEvery = 1000;  // journal entries per full snapshot
+
+    bool enabled = false;
+    std::string file = "autosave.txt";
+    uint64_t everyCommands = 100;
+    std::chrono::milliseconds interval{1000};
+    uint64_t pending = 0;
+    uint64_t saves = 0;
+    std::chrono::steady_clock::time_point lastSave;
+};
+
+void autosaveFlush(MatchingEngine& engine, Autosave& autosave) {
+    if (!autosave.enabled || autosave.pending == 0) return;
+    if (++autosave.saves % Autosave::kCompactEvery == 0) engine.checkpoint(autosave.file);
+    else engine.saveIncremental(autosave.file);
+    autosave.pending = 0;
+    autosave.lastSave = std::chrono::steady_clock::now();
+}
+
+// Called after every command that changed engine state.
+void autosaveTick(MatchingEngine& engine, Autosave& autosave) {
+    if (!autosave.enabled) return;
+    ++autosave.pending;
+    if (autosave.pending >= autosave.everyCommands ||
+        std::chrono::steady_clock::now() - autosave.lastSave >= autosave.interval) {
+        autosaveFlush(engine, autosave);
+    }
+}
+
 std::chrono::system_clock::time_point parseExpiry(const std::string& s) {
     if (s.empty()) return std::chrono::system_clock::time_point();
     std::tm tm = {};
@@ -60,23 +100,171 @@ std::chrono::system_clock::time_point parseExpiry(const std::string& s) {
     return std::chrono::system_clock::from_time_t(std::mktime(&tm));
 }
 
-int main() {
-    MatchingEngine engine;
+void printAllocationStats(const std::string& label, const AllocationStats& s) {
+    std::cout << std::left << std::setw(14) << label
+              << std::setw(12) << s.allocations << std::setw(12) << s.deallocations
+              << std::setw(16) << s.bytesAllocated << s.bytesInUse << "\n";
+}
+
+void printStats(const MatchingEngine& engine) {
+    MemoryStats mem = engine.getMemoryStats();
+    std::cout << "Memory resource: " << (mem.resource == MemoryResourceKind::Pool ? "pool" : "global") << "\n"
+              << std::left << std::setw(14) << "" << std::setw(12) << "Allocs" << std::setw(12) << "Frees"
+              << std::setw(16) << "BytesAlloc" << "BytesInUse" << "\n"
+              << std::string(66, '-') << "\n";
+    printAllocationStats("Containers", mem.containers);
+    printAllocationStats("Heap", mem.heap);
+    printAllocationStats("Last command", mem.lastCommand);
+    ArchiveStats archive = engine.getArchiveStats();
+    std::cout << "Archived orders: " << archive.orders << " (" << archive.bytes << " bytes, "
+              << archive.indexBlocks << " index blocks)\n";
+
+    nlohmann::json perf = engine.getPerfStats();
+    if (!perf.at("enabled").get<bool>()) return;
+    // Per-call averages; stages nest, so addOrder includes its match.
+    std::cout << std::left << std::setw(14) << "Stage" << std::setw(10) << "Calls" << std::setw(12) << "Cycles"
+              << std::setw(12) << "Instr" << std::setw(8) << "IPC" << std::setw(12) << "CacheMiss" << "BranchMiss\n"
+              << std::string(78, '-') << "\n";
+    for (const auto& [stage, s] : perf.at("stages").items()) {
+        const double calls = s.at("calls").get<double>();
+        const double cycles = s.at("cycles").get<double>();
+        std::cout << std::left << std::setw(14) << stage << std::setw(10) << s.at("calls").get<uint64_t>();
+        if (calls == 0) {
+            std::cout << "counters never scheduled (" << s.at("unscheduled").get<uint64_t>() << " calls)\n";
+            continue;
+        }
+        std::cout << std::fixed << std::setprecision(0) << std::setw(12) << cycles / calls
+                  << std::setw(12) << s.at("instructions").get<double>() / calls << std::setprecision(2)
+                  << std::setw(8) << (cycles > 0 ? s.at("instructions").get<double>() / cycles : 0.0)
+                  << std::setw(12) << s.at("cacheMisses").get<double>() / calls
+                  << s.at("branchMisses").get<double>() / calls << "\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+void printSaveStatus(const SaveStatus& status) {
+    switch (status.state) {
+        case SaveState::Idle:
+            std::cout << "No background save has run.\n";
+            return;
+        case SaveState::Running:
+            std::cout << "Saving to " << status.file << " (copy took " << status.copyMs << " ms)\n";
+            return;
+        case SaveState::Done:
+            std::cout << "Saved " << status.bytes << " bytes to " << status.file << " (copy " << status.copyMs
+                      << " ms, write " << status.writeMs << " ms)\n";
+            return;
+        case SaveState::Failed:
+            std::cout << "Save to " << status.file << " failed: " << status.error << "\n";
+            return;
+    }
+}
+
+// Prints the newest `count` bars of one interval.
+void printBars(const MatchingEngine& engine, int64_t intervalMs, std::size_t count) {
+    auto bars = engine.getBars(intervalMs, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max());
+    if (!bars) {
+        std::cerr << "Interval not configured; available:";
+        for (int64_t ms : engine.getBarIntervals()) std::cerr << " " << formatBarInterval(ms);
+        std::cerr << "\n";
+        return;
+    }
+    std::cout << std::left << std::setw(25) << "Start" << std::setw(10) << "Open" << std::setw(10) << "High"
+              << std::setw(10) << "Low" << std::setw(10) << "Close" << std::setw(10) << "Volume"
+              << std::setw(10) << "VWAP" << "Trades\n" << std::string(91, '-') << "\n";
+    const std::size_t first = bars->size() > count ? bars->size() - count : 0;
+    for (std::size_t i = first; i < bars->size(); ++i) {
+        const auto& b = (*bars)[i];
+        const auto start = std::chrono::system_clock::time_point(std::chrono::milliseconds(b.at("start").get<int64_t>()));
+        std::cout << std::left << std::setw(25) << Utils::formatTime(start)
+                  << std::setw(10) << b.at("open").get<double>() << std::setw(10) << b.at("high").get<double>()
+                  << std::setw(10) << b.at("low").get<double>() << std::setw(10) << b.at("close").get<double>()
+                  << std::setw(10) << b.at("volume").get<uint64_t>() << std::setw(10) << b.at("vwap").get<double>()
+                  << b.at("trades").get<uint64_t>() << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    MemoryResourceKind memoryKind = MemoryResourceKind::Pool;
+    std::string archivePath;
+    ClockKind clockKind = ClockKind::System;
+    bool batch = false;
+    bool quiet = false;
+    bool perf = false;
+    std::string scriptFile;
+    ValidationLimits limits;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (parseValidationArg(arg, limits)) continue;
+            if (arg == "--memory=global") memoryKind = MemoryResourceKind::Global;
+            else if (arg == "--memory=pool") memoryKind = MemoryResourceKind::Pool;
+            else if (arg.rfind("--archive=", 0) == 0) archivePath = arg.substr(10);
+            else if (arg.rfind("--clock=", 0) == 0) clockKind = parseClockKind(arg.substr(8));
+            else if (arg == "--batch") batch = true;
+            else if (arg.rfind("--batch=", 0) == 0) { batch = true; scriptFile = arg.substr(8); }
+            else if (arg == "--quiet") quiet = true;
+            else if (arg == "--perf") perf = true;
+            else {
+                std::cerr << "Usage: vortex [--batch[=<file>]] [--quiet] [--perf] [--memory=global|pool] [--archive=<file>]\n"
+                          << "              [--clock=system|monotonic|tsc] [--tick-size=<x>] [--lot-size=<n>]\n"
+                          << "              [--max-order-qty=<n>] [--price-band=<fraction>]\n";
+                return 1;
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+
+    MatchingEngine engine(memoryKind, archivePath);
+    if (clockKind == ClockKind::Tsc && !TscClock::available()) {
+        std::cerr << "Warning: no invariant TSC; using the monotonic clock" << std::endl;
+    }
+    engine.setClock(makeClock(clockKind));
+    engine.setTradeLogging(!quiet);
+    engine.setValidationLimits(limits);
+    std::string error;
+    if (perf && !engine.enablePerf(&error)) {
+        std::cerr << "Warning: hardware counters unavailable (" << error << "); continuing without --perf\n";
+    }
     std::string line;
-    bool autosaveEnabled = false;
-    std::string autosaveFile = "autosave.txt";
+    Autosave autosave;
+
+    // Batch mode streams commands from a file or pipe: no banner, no prompts,
+    // and stdout is only flushed when its buffer fills.
+    std::ifstream script;
+    if (!scriptFile.empty()) {
+        script.open(scriptFile);
+        if (!script.is_open()) {
+            std::cerr << "Error: Could not open script " << scriptFile << "\n";
+            return 1;
+        }
+    }
+    std::istream& in = script.is_open() ? script : std::cin;
+    if (batch) {
+        std::ios::sync_with_stdio(false);
+        std::cin.tie(nullptr);
+    } else {
+        std::cout << "Vortex Engine CLI\n";
+        printHelp();
+        std::cout << "Order IDs are shown after adding an order and are required for cancellation or modification.\n";
+    }
+    std::ostream nullStream(nullptr);
+    std::ostream& out = quiet ? nullStream : std::cout;
 
-    std::cout << "Vortex Engine CLI\n";
-    printHelp();
-    std::cout << "Order IDs are shown after adding an order and are required for cancellation or modification.\n";
+    uint64_t commands = 0, errors = 0;
+    const auto started = std::chrono::steady_clock::now();
 
     while (true) {
-        std::cout << "\n> ";
-        if (!std::getline(std::cin, line)) break;
+        if (!batch) std::cout << "\n> " << std::flush;
+        if (!std::getline(in, line)) break;
         std::istringstream iss(line);
         std::string cmd;
         iss >> cmd;
         cmd = toLower(cmd);
+        if (!cmd.empty() && cmd[0] != '#') ++commands;
         try {
             if (cmd == "add") {
                 std::string sideStr, typeStr, expiryStr;
@@ -88,24 +276,17 @@ int main() {
                 typeStr = toLower(typeStr);
 
                 if (sideStr.empty() || typeStr.empty() || qty == 0 ||
-                    (typeStr == "limit" && price <= 0) ||
-                    (typeStr == "iceberg" && !((iss >> peakSize) && peakSize > 0)) ||
-                    (typeStr == "stop" && !((iss >> stopPrice) && stopPrice > 0))) {
+                    (typeStr == "iceberg" && !(iss >> peakSize)) ||
+                    (typeStr == "stop" && !(iss >> stopPrice))) {
+                    ++errors;
                     std::cerr << "Usage: add <side> <type> <price> <quantity> [peakSize] [stopPrice] [expiry]\n";
                     continue;
                 }
-
-                // Parse optional peakSize and stopPrice for advanced types
-                if (typeStr == "iceberg" && peakSize == 0) {
-                    std::cerr << "Iceberg orders require peakSize > 0\n";
-                    continue;
-                }
-                if (typeStr == "stop" && stopPrice == 0) {
-                    std::cerr << "Stop orders require stopPrice > 0\n";
-                    continue;
-                }
-                if ((typeStr != "iceberg") && (iss >> peakSize)) {} // ignore peakSize for non-iceberg
-                if ((typeStr != "stop") && (iss >> stopPrice)) {}   // ignore stopPrice for non-stop
+                // Placeholder peakSize/stopPrice columns of other types are ignored.
+                uint64_t ignoredPeak = 0;
+                double ignoredStop = 0;
+                if ((typeStr != "iceberg") && (iss >> ignoredPeak)) {}
+                if ((typeStr != "stop") && (iss >> ignoredStop)) {}
 
                 // Optional expiry
                 iss >> expiryStr;
@@ -114,10 +295,6 @@ int main() {
                 OrderSide side = parseSide(sideStr);
                 OrderType type = parseType(typeStr);
 
-                // For non-iceberg, set peakSize=0; for non-stop, set stopPrice=0
-                if (type != OrderType::Iceberg) peakSize = 0;
-                if (type != OrderType::Stop) stopPrice = 0;
-
                 // Convert expiry to seconds from now (uint64_t)
                 uint64_t expirySec = 0;
                 if (expiry != std::chrono::system_clock::time_point()) {
@@ -126,12 +303,20 @@ int main() {
                     if (expirySec < 0) expirySec = 0;
                 }
 
-                uint64_t orderId = engine.addOrder(side, type, price, stopPrice, qty, peakSize, expirySec);
+                // Same pre-trade checks and rounding as the API server.
+                OrderCommand order{side, type, price, stopPrice, qty, peakSize, expirySec};
+                if (const char* rejection = engine.validateOrder(order)) {
+                    ++errors;
+                    std::cerr << "Order rejected: " << rejection << "\n";
+                    continue;
+                }
+                uint64_t orderId = engine.addOrder(order.side, order.type, order.price, order.stopPrice,
+                                                   order.quantity, order.peakSize, order.expirySec);
                 if (orderId != 0) {
-                    std::cout << "Order added to book with ID: " << orderId << std::endl;
-                    if (autosaveEnabled) engine.save(autosaveFile);
+                    out << "Order added to book with ID: " << orderId << '\n';
+                    autosaveTick(engine, autosave);
                 } else {
-                    std::cout << "Order fully matched (not resting in book) or invalid parameters." << std::endl;
+                    out << "Order fully matched (not resting in book) or invalid parameters.\n";
                 }
             } else if (cmd == "trades") {
                 engine.printTradeHistory();
@@ -141,14 +326,15 @@ int main() {
                 uint64_t orderId = 0;
                 iss >> orderId;
                 if (orderId == 0) {
+                    ++errors;
                     std::cerr << "Usage: cancel <orderId>\n";
                     continue;
                 }
                 if (engine.cancelOrder(orderId)) {
-                    std::cout << "Order " << orderId << " cancelled.\n";
-                    if (autosaveEnabled) engine.save(autosaveFile);
+                    out << "Order " << orderId << " cancelled.\n";
+                    autosaveTick(engine, autosave);
                 } else {
-                    std::cout << "Order " << orderId << " not found or already filled.\n";
+                    out << "Order " << orderId << " not found or already filled.\n";
                 }
             } else if (cmd == "modify") {
                 uint64_t orderId = 0;
@@ -156,55 +342,169 @@ int main() {
                 uint64_t newQty = 0;
                 iss >> orderId >> newPrice >> newQty;
                 if (orderId == 0 || newPrice <= 0 || newQty == 0) {
+                    ++errors;
                     std::cerr << "Usage: modify <orderId> <new_price> <new_quantity>\n";
                     continue;
                 }
                 if (engine.modifyOrder(orderId, newPrice, newQty)) {
-                    std::cout << "Order " << orderId << " modified.\n";
-                    if (autosaveEnabled) engine.save(autosaveFile);
+                    out << "Order " << orderId << " modified.\n";
+                    autosaveTick(engine, autosave);
+                } else {
+                    out << "Order " << orderId << " not found, already filled, or new quantity not above the filled quantity.\n";
+                }
+            } else if (cmd == "auction") {
+                std::string arg;
+                iss >> arg;
+                arg = toLower(arg);
+                if (arg == "start") {
+                    engine.beginAuction();
+                    autosaveTick(engine, autosave);
+                    out << "Auction phase started; orders will rest without matching.\n";
+                } else if (arg == "uncross") {
+                    std::size_t executed = engine.uncross();
+                    autosaveTick(engine, autosave);
+                    out << "Auction uncrossed with " << executed << " trade(s); continuous trading resumed.\n";
+                } else if (arg == "status") {
+                    AuctionIndicative ind = engine.getIndicativeUncross();
+                    std::cout << "Phase: " << (engine.getPhase() == TradingPhase::Auction ? "auction" : "continuous") << "\n";
+                    if (ind.volume > 0) {
+                        std::cout << "Indicative price: " << ind.price << ", volume: " << ind.volume
+                                  << " (buy " << ind.buyVolume << " / sell " << ind.sellVolume << ")\n";
+                    } else {
+                        std::cout << "Book does not cross.\n";
+                    }
+                } else {
+                    std::cout << "Usage: auction start|uncross|status\n";
+                }
+            } else if (cmd == "stats") {
+                std::string arg;
+                iss >> arg;
+                if (arg == "reset") {
+                    engine.resetPerf();
+                    out << "Performance counters reset.\n";
+                } else if (arg.empty()) {
+                    printStats(engine);
                 } else {
-                    std::cout << "Order " << orderId << " not found or already filled.\n";
+                    ++errors;
+                    std::cerr << "Usage: stats [reset]\n";
+                }
+            } else if (cmd == "bars") {
+                std::string interval;
+                std::size_t count = 20;
+                iss >> interval;
+                if (interval.empty() || (!iss.eof() && !(iss >> count))) {
+                    ++errors;
+                    std::cerr << "Usage: bars <interval> [count]\n";
+                    continue;
                 }
+                printBars(engine, parseBarInterval(interval), count);
             } else if (cmd == "save") {
-                std::string filename;
-                iss >> filename;
-                if (filename.empty()) {
-                    std::cerr << "Usage: save <filename>\n";
+                std::string filename, flag;
+                iss >> filename >> flag;
+                if (filename.empty() || (!flag.empty() && flag != "--no-history")) {
+                    ++errors;
+                    std::cerr << "Usage: save <filename> [--no-history]\n";
                     continue;
                 }
-                engine.save(filename);
-                std::cout << "Order book and trades saved to " << filename << "\n";
+                // A full save over the autosave base restarts its journal.
+                if (autosave.enabled && filename == autosave.file && flag.empty()) engine.checkpoint(filename);
+                else engine.save(filename, flag.empty());
+                out << "Order book and trades saved to " << filename << "\n";
+            } else if (cmd == "bgsave") {
+                std::string filename, flag;
+                iss >> filename >> flag;
+                if (filename.empty() || (!flag.empty() && flag != "--no-history")) {
+                    ++errors;
+                    std::cerr << "Usage: bgsave <filename> [--no-history]\n";
+                    continue;
+                }
+                if (!engine.saveInBackground(filename, flag.empty())) {
+                    ++errors;
+                    std::cerr << "A background save is already running; see savestatus\n";
+                    continue;
+                }
+                out << "Saving to " << filename << " in the background (engine paused "
+                    << engine.getSaveStatus().copyMs << " ms for the copy)\n";
+            } else if (cmd == "savestatus") {
+                printSaveStatus(engine.getSaveStatus());
             } else if (cmd == "load") {
                 std::string filename;
                 iss >> filename;
                 if (filename.empty()) {
+                    ++errors;
                     std::cerr << "Usage: load <filename>\n";
                     continue;
                 }
                 engine.load(filename);
-                std::cout << "Order book and trades loaded from " << filename << "\n";
+                // The journal only holds deltas, so restart it from the loaded state.
+                if (autosave.enabled) engine.checkpoint(autosave.file);
+                out << "Order book and trades loaded from " << filename << "\n";
             } else if (cmd == "autosave") {
-                std::string arg;
+                std::string arg, key;
                 iss >> arg;
                 if (arg == "on") {
-                    autosaveEnabled = true;
-                    std::cout << "Autosave enabled (file: " << autosaveFile << ")\n";
+                    Autosave next = autosave;
+                    bool valid = true;
+                    while (valid && iss >> key) {
+                        if (key == "every") valid = static_cast<bool>(iss >> next.everyCommands) && next.everyCommands > 0;
+                        else if (key == "interval") {
+                            long long ms = 0;
+                            valid = static_cast<bool>(iss >> ms) && ms > 0;
+                            next.interval = std::chrono::milliseconds(ms);
+                        }
+                        else if (key == "file") valid = static_cast<bool>(iss >> next.file);
+                        else valid = false;
+                    }
+                    if (!valid) {
+                        ++errors;
+                        std::cerr << "Usage: autosave on [every <n>] [interval <ms>] [file <name>] | off\n";
+                        continue;
+                    }
+                    autosaveFlush(engine, autosave);
+                    autosave = next;
+                    autosave.enabled = true;
+                    autosave.pending = 0;
+                    autosave.lastSave = std::chrono::steady_clock::now();
+                    engine.setChangeTracking(true);
+                    engine.checkpoint(autosave.file);
+                    out << "Autosave enabled (file: " << autosave.file << ", every " << autosave.everyCommands
+                        << " commands or " << autosave.interval.count() << " ms)\n";
                 } else if (arg == "off") {
-                    autosaveEnabled = false;
-                    std::cout << "Autosave disabled\n";
+                    autosaveFlush(engine, autosave);
+                    autosave.enabled = false;
+                    engine.setChangeTracking(false);
+                    out << "Autosave disabled\n";
                 } else {
-                    std::cout << "Usage: autosave on|off\n";
+                    std::cout << "Usage: autosave on [every <n>] [interval <ms>] [file <name>] | off\n";
                 }
             } else if(cmd == "help") {
                 printHelp();
             } else if (cmd == "quit") {
                 break;
-            } else if (!cmd.empty()) {
+            } else if (!cmd.empty() && cmd[0] != '#') {
+                ++errors;
                 std::cerr << "Unknown command: " << cmd << "\n";
             }
         } catch (const std::exception& ex) {
+            ++errors;
             std::cerr << "Error: " << ex.what() << "\n";
         }
     }
+    try {
+        autosaveFlush(engine, autosave);
+    } catch (const std::exception& ex) {
+        ++errors;
+        std::cerr << "Error: " << ex.what() << "\n";
+    }
+
+    if (batch) {
+        std::cout.flush();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        std::cerr << "Processed " << commands << " commands (" << errors << " errors) in "
+                  << std::fixed << std::setprecision(3) << seconds << " s, "
+                  << std::setprecision(0) << (seconds > 0 ? static_cast<double>(commands) / seconds : 0.0)
+                  << " commands/s; " << engine.getTradeCount() << " trades, "
+                  << autosave.saves << " autosaves\n";
+    }
     return 0;
 }
@@ -1,30 +1,121 @@
 #include "vortex/matching_engine.h"
 #include "vortex/Utils.h"
-#include <thread>
+#include "vortex/Threading.h"
+#include <cstdio>
+#include <iostream>
+#include <algorithm>
+#include <sstream>
 
-MatchingEngine::MatchingEngine() {}
+namespace {
+
+// Stamps everything inside it, including the replication event, with one
+// clock read, so a replica that sets its clock to the event's "t" computes
+// the same timestamps and expiries.
+class StampScope {
+public:
+    explicit StampScope(OrderBook& book) : book(book) { book.beginBatch(); }
+    ~StampScope() { book.endBatch(); }
+private:
+    OrderBook& book;
+};
+
+nlohmann::json addEvent(uint64_t orderId, OrderSide side, OrderType type, double price, double stopPrice,
+                        uint64_t quantity, uint64_t peakSize, uint64_t expirySec) {
+    return nlohmann::json{
+        {"e", "add"}, {"id", orderId}, {"side", side}, {"type", type}, {"price", price}, {"stopPrice", stopPrice},
+        {"quantity", quantity}, {"peakSize", peakSize}, {"expirySec", expirySec}
+    };
+}
+
+}
+
+MatchingEngine::MatchingEngine(MemoryResourceKind memoryKind, const std::string& archivePath)
+    : clock(makeClock(ClockKind::System)), orderBook(memoryKind, archivePath),
+      instanceId(static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count())) {
+    orderBook.setClock(clock.get());
+}
+
+MatchingEngine::~MatchingEngine() {
+    stop(false);
+    waitForSave();
+}
+
+void MatchingEngine::setClock(std::unique_ptr<EngineClock> newClock) {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    clock = std::move(newClock);
+    orderBook.setClock(clock.get());
+}
 
 // --- High-Performance API Methods ---
 
-void MatchingEngine::postOrder(OrderSide side, OrderType type, double price, double stopPrice,
-                                 uint64_t quantity, uint64_t peakSize, uint64_t expirySec) {
-    OrderCommand cmd = {side, type, price, stopPrice, quantity, peakSize, expirySec};
+const char* MatchingEngine::postOrder(OrderCommand cmd) {
+    if (const char* error = validator.validate(cmd)) return error;
     workQueue.push(cmd);
+    return nullptr;
 }
 
-void MatchingEngine::run() {
-    std::thread([this]() {
-        while (true) {
-            OrderCommand cmd;
-            workQueue.wait_and_pop(cmd);
-            processOrder(cmd);
+void MatchingEngine::start(const EngineRunConfig& config) {
+    if (engineThread.joinable()) return;
+    stopRequested.store(false);
+    discardOnStop.store(false);
+    workQueue.reopen();
+    engineThread = std::thread(&MatchingEngine::runLoop, this, config);
+}
+
+void MatchingEngine::stop(bool drain) {
+    if (!engineThread.joinable()) return;
+    discardOnStop.store(!drain);
+    stopRequested.store(true);
+    workQueue.close();
+    engineThread.join();
+}
+
+void MatchingEngine::runLoop(EngineRunConfig config) {
+    if (config.cpu >= 0 && !Threading::pinCurrentThread(config.cpu)) {
+        std::cerr << "Warning: could not pin engine thread to CPU " << config.cpu << std::endl;
+    }
+    OrderCommand cmd;
+    while (!discardOnStop.load(std::memory_order_relaxed)) {
+        if (config.busyPoll) {
+            if (!workQueue.try_pop(cmd)) {
+                if (stopRequested.load(std::memory_order_relaxed)) break;
+                Threading::cpuRelax();
+                continue;
+            }
+        } else if (!workQueue.wait_and_pop(cmd)) {
+            break;  // closed and drained
         }
-    }).detach();
+        std::lock_guard<std::mutex> lock(engine_mutex);
+        // One clock read stamps this command and whatever queued up behind it.
+        orderBook.beginBatch();
+        std::size_t processed = 0;
+        do {
+            processOrder(cmd);
+        } while (++processed < kMaxBatch && workQueue.try_pop(cmd));
+        orderBook.endBatch();
+        publishMarketState();
+    }
 }
 
 void MatchingEngine::processOrder(const OrderCommand& cmd) {
-    std::lock_guard<std::mutex> lock(engine_mutex);
-    Order order;
+    switch (cmd.kind) {
+        case CommandKind::Cancel:
+            if (orderBook.cancelOrder(cmd.orderId)) emit({{"e", "cancel"}, {"id", cmd.orderId}});
+            return;
+        case CommandKind::Amend: {
+            const Order* existing = orderBook.getAllOrders().find(cmd.orderId);
+            if (!existing) return;
+            const double price = cmd.price > 0 ? cmd.price : existing->price;
+            const uint64_t quantity = cmd.quantity > 0 ? cmd.quantity : existing->quantity;
+            if (orderBook.modifyOrder(cmd.orderId, price, quantity)) {
+                emit({{"e", "modify"}, {"id", cmd.orderId}, {"price", price}, {"quantity", quantity}});
+            }
+            return;
+        }
+        case CommandKind::New:
+            break;
+    }
+    Order order{};
     order.side = cmd.side;
     order.type = cmd.type;
     order.price = cmd.price;
@@ -32,11 +123,12 @@ void MatchingEngine::processOrder(const OrderCommand& cmd) {
     order.quantity = cmd.quantity;
     order.peakSize = cmd.peakSize;
     if (cmd.expirySec > 0) {
-        order.expiry = Utils::now() + std::chrono::seconds(cmd.expirySec);
+        order.expiry = orderBook.currentTime() + std::chrono::seconds(cmd.expirySec);
     } else {
         order.expiry = std::chrono::system_clock::time_point::min();
     }
-    orderBook.addOrder(std::move(order));
+    const uint64_t orderId = orderBook.addOrder(std::move(order));
+    emit(addEvent(orderId, cmd.side, cmd.type, cmd.price, cmd.stopPrice, cmd.quantity, cmd.peakSize, cmd.expirySec));
 }
 
 
@@ -44,7 +136,8 @@ void MatchingEngine::processOrder(const OrderCommand& cmd) {
 
 uint64_t MatchingEngine::addOrder(OrderSide side, OrderType type, double price, double stopPrice, uint64_t quantity, uint64_t peakSize, uint64_t expirySec) {
     std::lock_guard<std::mutex> lock(engine_mutex);
-    Order order;
+    StampScope stamp(orderBook);
+    Order order{};
     order.side = side;
     order.type = type;
     order.price = price;
@@ -52,21 +145,78 @@ uint64_t MatchingEngine::addOrder(OrderSide side, OrderType type, double price,
     order.quantity = quantity;
     order.peakSize = peakSize;
      if (expirySec > 0) {
-        order.expiry = Utils::now() + std::chrono::seconds(expirySec);
+        order.expiry = orderBook.currentTime() + std::chrono::seconds(expirySec);
     } else {
         order.expiry = std::chrono::system_clock::time_point::min();
     }
-    return orderBook.addOrder(std::move(order));
+    const uint64_t orderId = orderBook.addOrder(std::move(order));
+    emit(addEvent(orderId, side, type, price, stopPrice, quantity, peakSize, expirySec));
+    publishMarketState();
+    return orderId;
 }
 
 bool MatchingEngine::cancelOrder(uint64_t orderId) {
     std::lock_guard<std::mutex> lock(engine_mutex);
-    return orderBook.cancelOrder(orderId);
+    StampScope stamp(orderBook);
+    const bool cancelled = orderBook.cancelOrder(orderId);
+    if (cancelled) emit({{"e", "cancel"}, {"id", orderId}});
+    publishMarketState();
+    return cancelled;
 }
 
 bool MatchingEngine::modifyOrder(uint64_t orderId, double newPrice, uint64_t newQuantity) {
     std::lock_guard<std::mutex> lock(engine_mutex);
-    return orderBook.modifyOrder(orderId, newPrice, newQuantity);
+    StampScope stamp(orderBook);
+    const bool modified = orderBook.modifyOrder(orderId, newPrice, newQuantity);
+    if (modified) emit({{"e", "modify"}, {"id", orderId}, {"price", newPrice}, {"quantity", newQuantity}});
+    publishMarketState();
+    return modified;
+}
+
+void MatchingEngine::publishMarketState() {
+    const TopOfBook& top = orderBook.getTopOfBook();
+    const auto& trades = orderBook.getTrades();
+    if (!trades.empty()) {
+        validator.setReferencePrice(trades.back().price);
+    } else if (top.bidSize > 0 && top.askSize > 0) {
+        validator.setReferencePrice((top.bidPrice + top.askPrice) / 2);
+    } else {
+        validator.setReferencePrice(0.0);
+    }
+
+    std::lock_guard<std::mutex> lock(topMutex);
+    if (top.sequence == publishedTop.sequence) return;
+    publishedTop = top;
+    topChanged.notify_all();
+}
+
+
+// --- Auction Phase Control ---
+
+void MatchingEngine::beginAuction() {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    StampScope stamp(orderBook);
+    orderBook.beginAuction();
+    emit({{"e", "auction"}});
+}
+
+std::size_t MatchingEngine::uncross() {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    StampScope stamp(orderBook);
+    const std::size_t executed = orderBook.uncross();
+    emit({{"e", "uncross"}});
+    publishMarketState();
+    return executed;
+}
+
+TradingPhase MatchingEngine::getPhase() const {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    return orderBook.getPhase();
+}
+
+AuctionIndicative MatchingEngine::getIndicativeUncross() const {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    return orderBook.getIndicativeUncross();
 }
 
 
@@ -82,28 +232,133 @@ void MatchingEngine::printTradeHistory() const {
     orderBook.printTradeHistory();
 }
 
-void MatchingEngine::save(const std::string& filename) const {
-    std::lock_guard<std::mutex> lock(engine_mutex);
-    orderBook.save(filename);
+void MatchingEngine::save(const std::string& filename, bool includeHistory) const {
+    BookSnapshot snapshot;
+    bool profiled;
+    {
+        std::lock_guard<std::mutex> lock(engine_mutex);
+        snapshot = orderBook.snapshot(includeHistory);
+        profiled = orderBook.getPerfProfile().enabled();
+    }
+    writeSnapshot(snapshot, filename, profiled);
+}
+
+uint64_t MatchingEngine::writeSnapshot(const BookSnapshot& snapshot, const std::string& filename, bool profiled) const {
+    PerfSample start, end;
+    profiled = profiled && readPerfCounters(start);
+    const uint64_t bytes = snapshot.writeFile(filename);
+    if (profiled && readPerfCounters(end)) {
+        std::lock_guard<std::mutex> lock(engine_mutex);
+        orderBook.recordPerf(PerfStage::Serialize, start, end);
+    }
+    return bytes;
+}
+
+bool MatchingEngine::saveInBackground(const std::string& filename, bool includeHistory) {
+    std::lock_guard<std::mutex> saveLock(saveMutex);
+    if (saveStatus.state == SaveState::Running) return false;
+    if (saveThread.joinable()) saveThread.join();
+
+    const auto copyStart = std::chrono::steady_clock::now();
+    auto snapshot = std::make_shared<BookSnapshot>();
+    bool profiled;
+    {
+        std::lock_guard<std::mutex> lock(engine_mutex);
+        *snapshot = orderBook.snapshot(includeHistory);
+        profiled = orderBook.getPerfProfile().enabled();
+    }
+    const auto copyEnd = std::chrono::steady_clock::now();
+    saveStatus = SaveStatus{};
+    saveStatus.state = SaveState::Running;
+    saveStatus.file = filename;
+    saveStatus.copyMs = std::chrono::duration<double, std::milli>(copyEnd - copyStart).count();
+
+    saveThread = std::thread([this, snapshot, filename, profiled] {
+        const auto writeStart = std::chrono::steady_clock::now();
+        SaveState state = SaveState::Done;
+        std::string error;
+        uint64_t bytes = 0;
+        try {
+            bytes = writeSnapshot(*snapshot, filename, profiled);
+        } catch (const std::exception& e) {
+            state = SaveState::Failed;
+            error = e.what();
+        }
+        const double writeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - writeStart).count();
+        std::lock_guard<std::mutex> lock(saveMutex);
+        saveStatus.state = state;
+        saveStatus.error = std::move(error);
+        saveStatus.bytes = bytes;
+        saveStatus.writeMs = writeMs;
+    });
+    return true;
+}
+
+SaveStatus MatchingEngine::getSaveStatus() const {
+    std::lock_guard<std::mutex> lock(saveMutex);
+    return saveStatus;
+}
+
+// The save thread takes saveMutex to report its result, so join outside it.
+void MatchingEngine::waitForSave() {
+    std::thread running;
+    {
+        std::lock_guard<std::mutex> lock(saveMutex);
+        running = std::move(saveThread);
+    }
+    if (running.joinable()) running.join();
 }
 
 void MatchingEngine::load(const std::string& filename) {
+    waitForSave();
     std::lock_guard<std::mutex> lock(engine_mutex);
+    finishSnapshots();
     orderBook.load(filename);
+    emitSnapshot();
+    publishMarketState();
+}
+
+void MatchingEngine::setChangeTracking(bool enabled) {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    orderBook.setChangeTracking(enabled);
+}
+
+void MatchingEngine::saveIncremental(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    orderBook.saveIncremental(filename);
+}
+
+void MatchingEngine::checkpoint(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    orderBook.checkpoint(filename);
+}
+
+void MatchingEngine::setTradeLogging(bool enabled) {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    orderBook.setTradeLogging(enabled);
+}
+
+std::size_t MatchingEngine::getTradeCount() const {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    return orderBook.getTrades().size();
+}
+
+uint64_t MatchingEngine::getTradeSequence() const {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    return orderBook.getTradeSequence();
 }
 
 std::optional<Order> MatchingEngine::getOrderById(uint64_t orderId) const {
     std::lock_guard<std::mutex> lock(engine_mutex);
-    const auto& allOrders = orderBook.getAllOrders();
-    auto it = allOrders.find(orderId);
-    if (it != allOrders.end()) {
-        return it->second;
-    }
-    return std::nullopt;
+    return orderBook.findOrder(orderId);
 }
 
 nlohmann::json MatchingEngine::getOrderBookSnapshot() const {
     std::lock_guard<std::mutex> lock(engine_mutex);
+    return orderBookJson();
+}
+
+nlohmann::json MatchingEngine::orderBookJson() const {
     nlohmann::json j;
     j["buy"] = nlohmann::json::array();
     j["sell"] = nlohmann::json::array();
@@ -119,4 +374,186 @@ nlohmann::json MatchingEngine::getOrderBookSnapshot() const {
 nlohmann::json MatchingEngine::getTradeHistory() const {
     std::lock_guard<std::mutex> lock(engine_mutex);
     return nlohmann::json(orderBook.getTrades());
-}
\ No newline at end of file
+}
+
+// The JSON is built under the engine lock, but dump() runs after releasing it.
+EncodedSnapshot MatchingEngine::getOrderBookEncoded() const {
+    nlohmann::json j;
+    uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(engine_mutex);
+        sequence = orderBook.getBookSequence();
+        if (auto cached = bookCache.get(sequence)) return *cached;
+        j = orderBookJson();
+    }
+    return bookCache.put(makeSnapshot('b', sequence, j.dump()));
+}
+
+EncodedSnapshot MatchingEngine::getTradesEncoded() const {
+    nlohmann::json j;
+    uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(engine_mutex);
+        sequence = orderBook.getTradeSequence();
+        if (auto cached = tradeCache.get(sequence)) return *cached;
+        j = orderBook.getTrades();
+    }
+    return tradeCache.put(makeSnapshot('t', sequence, j.dump()));
+}
+
+EncodedSnapshot MatchingEngine::makeSnapshot(char view, uint64_t sequence, std::string body) const {
+    EncodedSnapshot snapshot;
+    snapshot.sequence = sequence;
+    char tag[48];
+    std::snprintf(tag, sizeof(tag), "\"%llx-%c%llu\"", static_cast<unsigned long long>(instanceId), view,
+                  static_cast<unsigned long long>(sequence));
+    snapshot.etag = tag;
+    snapshot.body = std::make_shared<const std::string>(std::move(body));
+    return snapshot;
+}
+
+std::optional<EncodedSnapshot> MatchingEngine::SnapshotCache::get(uint64_t sequence) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!current.body || current.sequence != sequence) return std::nullopt;
+    return current;
+}
+
+EncodedSnapshot MatchingEngine::SnapshotCache::put(EncodedSnapshot snapshot) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!current.body || snapshot.sequence > current.sequence) current = std::move(snapshot);
+    return current;
+}
+
+TopOfBook MatchingEngine::getTopOfBook() const {
+    std::lock_guard<std::mutex> lock(topMutex);
+    return publishedTop;
+}
+
+TopOfBook MatchingEngine::waitForTopOfBook(uint64_t sequence, std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(topMutex);
+    topChanged.wait_for(lock, timeout, [&] { return publishedTop.sequence != sequence; });
+    return publishedTop;
+}
+
+nlohmann::json MatchingEngine::getAuctionStatus() const {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    return nlohmann::json{
+        {"phase", orderBook.getPhase()},
+        {"indicative", orderBook.getIndicativeUncross()}
+    };
+}
+
+std::optional<nlohmann::json> MatchingEngine::getBars(int64_t intervalMs, int64_t fromMs, int64_t toMs) const {
+    std::vector<Bar> bars;
+    {
+        std::lock_guard<std::mutex> lock(engine_mutex);
+        const BarSeries* series = orderBook.getBars().find(intervalMs);
+        if (!series) return std::nullopt;
+        bars = series->query(fromMs, toMs);
+    }
+    return BarSeries::toJson(bars, intervalMs);
+}
+
+std::vector<int64_t> MatchingEngine::getBarIntervals() const {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    std::vector<int64_t> intervals;
+    for (const auto& series : orderBook.getBars().getSeries()) intervals.push_back(series.intervalMs());
+    return intervals;
+}
+
+void MatchingEngine::setBarSpecs(const std::vector<BarSpec>& specs) {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    orderBook.setBarSpecs(specs);
+}
+
+MemoryStats MatchingEngine::getMemoryStats() const {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    return orderBook.getMemoryStats();
+}
+
+ArchiveStats MatchingEngine::getArchiveStats() const {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    return orderBook.getArchive().stats();
+}
+
+bool MatchingEngine::enablePerf(std::string* error) {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    return orderBook.getPerfProfile().enable(error);
+}
+
+void MatchingEngine::resetPerf() {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    orderBook.getPerfProfile().reset();
+}
+
+nlohmann::json MatchingEngine::getPerfStats() const {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    const PerfProfile& perf = orderBook.getPerfProfile();
+    return nlohmann::json{{"enabled", perf.enabled()}, {"stages", perf.toJson()}};
+}
+
+
+// --- Replication ---
+
+void MatchingEngine::subscribe(ReplicationSink* sink) {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    sinks.push_back(sink);
+    emitSnapshot(sink);
+}
+
+void MatchingEngine::unsubscribe(ReplicationSink* sink) {
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    sinks.erase(std::remove(sinks.begin(), sinks.end(), sink), sinks.end());
+}
+
+void MatchingEngine::loadSnapshot(const nlohmann::json& state) {
+    waitForSave();
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    finishSnapshots();
+    orderBook.loadSnapshot(state);
+    emitSnapshot();
+    publishMarketState();
+}
+
+void MatchingEngine::emit(nlohmann::json event) {
+    if (sinks.empty()) return;
+    event["t"] = Utils::toEpochNanos(orderBook.currentTime());
+    const std::string line = event.dump();
+    for (ReplicationSink* sink : sinks) sink->onEvent(line);
+}
+
+// Also serves replicas of this replica, which is why loadSnapshot() calls it.
+// Only the copy is taken here; sinks serialize it on their own threads.
+void MatchingEngine::emitSnapshot(ReplicationSink* only) {
+    if (sinks.empty()) return;
+    auto event = std::make_shared<const SnapshotEvent>(orderBook.snapshot(true));
+    sentSnapshots.erase(std::remove_if(sentSnapshots.begin(), sentSnapshots.end(),
+                                       [](const auto& sent) { return sent.expired(); }), sentSnapshots.end());
+    sentSnapshots.push_back(event);
+    if (only) {
+        only->onSnapshot(event);
+    } else {
+        for (ReplicationSink* sink : sinks) sink->onSnapshot(event);
+    }
+}
+
+void MatchingEngine::finishSnapshots() {
+    for (const auto& sent : sentSnapshots) {
+        if (auto event = sent.lock()) event->line();
+    }
+    sentSnapshots.clear();
+}
+
+const std::string& SnapshotEvent::line() const {
+    std::call_once(encoded, [this] {
+        std::ostringstream out;
+        out << R"({"e":"snapshot","state":)";
+        snapshot.write(out);
+        out << '}';
+        text = out.str();
+        // write() only breaks lines between elements (newlines inside strings
+        // are escaped), so this keeps the event on one line.
+        std::replace(text.begin(), text.end(), '\n', ' ');
+    });
+    return text;
+}